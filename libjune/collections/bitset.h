@@ -0,0 +1,192 @@
+/// @file libjune/collections/bitset.h
+
+#ifndef LIBJUNE_COLLECTIONS_BITSET_H
+#define LIBJUNE_COLLECTIONS_BITSET_H
+
+#include <libjune/memory.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/// @brief Fixed-size array of bits, stored 64 to a word. The words start on a
+/// cache line boundary.
+typedef struct {
+  lj_allocator_t *allocator;
+  size_t num_bits;
+  size_t num_words;
+  uint64_t *words;
+  void *buffer;
+} lj_bitset_t;
+
+/// @brief Count the set bits in a word.
+/// @param word The word in question.
+/// @return The number of set bits.
+unsigned int lj_popcount64(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned int)__builtin_popcountll(word);
+#else
+  word = word - ((word >> 1) & 0x5555555555555555ULL);
+  word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+  word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (unsigned int)((word * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/// @brief Create a new bitset with every bit clear.
+/// @param num_bits The number of bits.
+/// @param allocator The allocator to use.
+/// @return The new bitset. If allocation failed, its words are NULL and it
+/// holds no bits.
+lj_bitset_t lj_new_bitset(size_t num_bits, lj_allocator_t *allocator) {
+  size_t num_words = (num_bits + 63U) / 64U;
+  char *buffer = (char *)lj_allocate(allocator, num_words * sizeof(uint64_t) +
+                                                    LJ_CACHE_LINE_SIZE_K);
+  if (buffer == NULL) {
+    return (lj_bitset_t){.allocator = allocator};
+  }
+  uintptr_t misalignment = (uintptr_t)buffer % LJ_CACHE_LINE_SIZE_K;
+  uint64_t *words =
+      (uint64_t *)(buffer + (misalignment == 0U
+                                 ? 0U
+                                 : LJ_CACHE_LINE_SIZE_K - misalignment));
+  memset(words, 0, num_words * sizeof(uint64_t));
+  return (lj_bitset_t){
+      .allocator = allocator,
+      .num_bits = num_bits,
+      .num_words = num_words,
+      .words = words,
+      .buffer = buffer,
+  };
+}
+
+/// @brief Delete a bitset and free its memory.
+/// @param bits The bitset to delete.
+void lj_bitset_delete(lj_bitset_t *bits) {
+  lj_deallocate(bits->allocator, bits->buffer);
+  bits->words = NULL;
+  bits->buffer = NULL;
+  bits->num_bits = bits->num_words = 0U;
+}
+
+/// @brief Gets the number of bits in a bitset.
+/// @param bits The bitset in question.
+/// @return The number of bits.
+size_t lj_bitset_size(lj_bitset_t *bits) { return bits->num_bits; }
+
+/// @brief Set a bit.
+/// @param bits The bitset in question.
+/// @param ind The index of the bit.
+/// @return A bool; if false, the index was out of range and the bitset is
+/// unchanged.
+bool lj_bitset_set(lj_bitset_t *bits, size_t ind) {
+  if (ind >= bits->num_bits) {
+    return false;
+  }
+  bits->words[ind / 64U] |= (uint64_t)1U << (ind % 64U);
+  return true;
+}
+
+/// @brief Clear a bit.
+/// @param bits The bitset in question.
+/// @param ind The index of the bit.
+/// @return A bool; if false, the index was out of range and the bitset is
+/// unchanged.
+bool lj_bitset_clear(lj_bitset_t *bits, size_t ind) {
+  if (ind >= bits->num_bits) {
+    return false;
+  }
+  bits->words[ind / 64U] &= ~((uint64_t)1U << (ind % 64U));
+  return true;
+}
+
+/// @brief Check a bit.
+/// @param bits The bitset in question.
+/// @param ind The index of the bit.
+/// @return A bool indicating if the bit is set. Out of range bits are never
+/// set.
+bool lj_bitset_test(lj_bitset_t *bits, size_t ind) {
+  if (ind >= bits->num_bits) {
+    return false;
+  }
+  return (bits->words[ind / 64U] >> (ind % 64U)) & 1U;
+}
+
+/// @brief Clear every bit.
+/// @param bits The bitset in question.
+void lj_bitset_clear_all(lj_bitset_t *bits) {
+  memset(bits->words, 0, bits->num_words * sizeof(uint64_t));
+}
+
+/// @brief Count the set bits in a bitset.
+/// @param bits The bitset in question.
+/// @return The number of set bits.
+size_t lj_bitset_count(lj_bitset_t *bits) {
+  size_t total = 0U;
+  for (size_t i = 0; i < bits->num_words; i++) {
+    total += lj_popcount64(bits->words[i]);
+  }
+  return total;
+}
+
+/// @brief Count the set bits before an index.
+/// @param bits The bitset in question.
+/// @param ind The index to stop at. Indices past the end count every bit.
+/// @return The number of set bits in [0, ind).
+size_t lj_bitset_rank(lj_bitset_t *bits, size_t ind) {
+  if (ind > bits->num_bits) {
+    ind = bits->num_bits;
+  }
+  size_t total = 0U;
+  for (size_t i = 0; i < ind / 64U; i++) {
+    total += lj_popcount64(bits->words[i]);
+  }
+  if (ind % 64U != 0U) {
+    uint64_t mask = ((uint64_t)1U << (ind % 64U)) - 1U;
+    total += lj_popcount64(bits->words[ind / 64U] & mask);
+  }
+  return total;
+}
+
+/// @brief Intersect one bitset into another.
+/// @param dst The bitset to modify.
+/// @param src The bitset to intersect with.
+/// @return A bool; if false, the bitsets differ in size and dst is unchanged.
+bool lj_bitset_and(lj_bitset_t *dst, lj_bitset_t *src) {
+  if (dst->num_bits != src->num_bits) {
+    return false;
+  }
+  for (size_t i = 0; i < dst->num_words; i++) {
+    dst->words[i] &= src->words[i];
+  }
+  return true;
+}
+
+/// @brief Union one bitset into another.
+/// @param dst The bitset to modify.
+/// @param src The bitset to union with.
+/// @return A bool; if false, the bitsets differ in size and dst is unchanged.
+bool lj_bitset_or(lj_bitset_t *dst, lj_bitset_t *src) {
+  if (dst->num_bits != src->num_bits) {
+    return false;
+  }
+  for (size_t i = 0; i < dst->num_words; i++) {
+    dst->words[i] |= src->words[i];
+  }
+  return true;
+}
+
+/// @brief Take the symmetric difference of one bitset into another.
+/// @param dst The bitset to modify.
+/// @param src The other bitset.
+/// @return A bool; if false, the bitsets differ in size and dst is unchanged.
+bool lj_bitset_xor(lj_bitset_t *dst, lj_bitset_t *src) {
+  if (dst->num_bits != src->num_bits) {
+    return false;
+  }
+  for (size_t i = 0; i < dst->num_words; i++) {
+    dst->words[i] ^= src->words[i];
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include <libjune/collections/bitset.h>
+#include <libjune/unit.h>
+#include <stdio.h>
+
+static char *test_set_test_rank(void) {
+  lj_bitset_t bits = lj_new_bitset(200, &lj_default_allocator);
+  lj_assert((uintptr_t)bits.words % LJ_CACHE_LINE_SIZE_K == 0,
+            "words should start on a cache line");
+  for (size_t i = 0; i < 200; i += 3) {
+    lj_assert(lj_bitset_set(&bits, i), "index should be within range");
+  }
+  lj_assert(!lj_bitset_set(&bits, 200), "index 200 should be out of range");
+  lj_assert(lj_bitset_test(&bits, 99) && !lj_bitset_test(&bits, 100),
+            "only the bits that were set should test true");
+  lj_assert(lj_bitset_count(&bits) == 67, "67 bits should be set");
+  lj_assert(lj_bitset_rank(&bits, 64) == 22,
+            "22 multiples of 3 are below 64");
+  lj_assert(lj_bitset_rank(&bits, 1000) == 67,
+            "rank past the end should count every bit");
+  lj_bitset_clear(&bits, 99);
+  lj_assert(!lj_bitset_test(&bits, 99), "cleared bits should test false");
+  lj_bitset_delete(&bits);
+  return 0;
+}
+
+static char *test_bulk_operations(void) {
+  lj_bitset_t evens = lj_new_bitset(100, &lj_default_allocator);
+  lj_bitset_t threes = lj_new_bitset(100, &lj_default_allocator);
+  lj_bitset_t other = lj_new_bitset(101, &lj_default_allocator);
+  for (size_t i = 0; i < 100; i++) {
+    if (i % 2 == 0) {
+      lj_bitset_set(&evens, i);
+    }
+    if (i % 3 == 0) {
+      lj_bitset_set(&threes, i);
+    }
+  }
+  lj_assert(!lj_bitset_or(&evens, &other),
+            "bitsets of different sizes should not combine");
+  lj_assert(lj_bitset_xor(&evens, &threes), "same-size bitsets should combine");
+  lj_assert(lj_bitset_count(&evens) == 50 + 34 - 2 * 17,
+            "xor should drop the common bits");
+  lj_assert(lj_bitset_or(&evens, &threes) && lj_bitset_count(&evens) == 67,
+            "or after xor should give the union");
+  lj_assert(lj_bitset_and(&evens, &threes) && lj_bitset_count(&evens) == 34,
+            "and with a subset should give the subset");
+  lj_bitset_delete(&evens);
+  lj_bitset_delete(&threes);
+  lj_bitset_delete(&other);
+  return 0;
+}
+
+int main(const int argc, const char **argv) {
+  lj_run_test(test_set_test_rank);
+  lj_run_test(test_bulk_operations);
+  lj_finish_tests();
+  return 0;
+}
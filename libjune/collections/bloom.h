@@ -0,0 +1,323 @@
+/// @file libjune/collections/bloom.h
+/// Uses log(3) and lgamma(3), so programs including this need the math library
+/// (-lm on most Unix-like systems).
+
+#ifndef LIBJUNE_COLLECTIONS_BLOOM_H
+#define LIBJUNE_COLLECTIONS_BLOOM_H
+
+#include <libjune/collections/bitset.h>
+#include <libjune/memory.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/// @brief Number of bits in one block of a Bloom filter; one cache line.
+#define LJ_BLOOM_BLOCK_BITS_K (LJ_CACHE_LINE_SIZE_K * 8U)
+
+/// @private
+/// Bits of hash it takes to pick one bit of a block.
+#if LJ_BLOOM_BLOCK_BITS_K == 256U
+#define LJI_BLOOM_PROBE_BITS_K 8U
+#elif LJ_BLOOM_BLOCK_BITS_K == 512U
+#define LJI_BLOOM_PROBE_BITS_K 9U
+#elif LJ_BLOOM_BLOCK_BITS_K == 1024U
+#define LJI_BLOOM_PROBE_BITS_K 10U
+#elif LJ_BLOOM_BLOCK_BITS_K == 2048U
+#define LJI_BLOOM_PROBE_BITS_K 11U
+#else
+#error "libjune/collections/bloom.h requires a cache line of 32, 64, 128 or 256 bytes"
+#endif
+
+/// @private
+#define LJI_BLOOM_MAGIC_K 0x6C6A626C6F6F6D32ULL
+
+/// @brief Probabilistic set that can say an element is definitely absent or
+/// possibly present. All the bits for an element live in one cache-line-sized
+/// block, so a lookup touches a single line. Put one in front of an
+/// lj_hashset_t to skip the bucket scan for most misses.
+typedef struct {
+  lj_bitset_t bits;
+  size_t num_blocks;
+  size_t num_hashes;
+  size_t element_size;
+  size_t (*hash_fn)(void *);
+} lj_bloom_filter_t;
+
+/// @private
+lj_bloom_filter_t lji_bloom_filter_with_blocks(size_t num_blocks,
+                                               size_t num_hashes,
+                                               size_t element_size,
+                                               size_t (*hash_fn)(void *),
+                                               lj_allocator_t *allocator) {
+  lj_bloom_filter_t filter = {
+      .bits = lj_new_bitset(num_blocks * LJ_BLOOM_BLOCK_BITS_K, allocator),
+      .num_blocks = num_blocks,
+      .num_hashes = num_hashes,
+      .element_size = element_size,
+      .hash_fn = hash_fn,
+  };
+  if (filter.bits.words == NULL) {
+    filter.num_blocks = 0U;
+  }
+  return filter;
+}
+
+/// @private
+/// Expected false positive rate of a blocked filter with the given space per
+/// element and number of hashes. The number of elements landing in a block is
+/// Poisson distributed, and each block behaves like a small ordinary filter.
+double lji_bloom_blocked_rate(double bits_per_element, size_t num_hashes) {
+  double block_bits = (double)LJ_BLOOM_BLOCK_BITS_K;
+  double mean = block_bits / bits_per_element;
+  double spread = 12.0 * sqrt(mean) + 10.0;
+  double low = mean - spread > 0.0 ? floor(mean - spread) : 0.0;
+  double rate = 0.0;
+  for (double count = low; count <= mean + spread; count += 1.0) {
+    double weight = exp(count * log(mean) - mean - lgamma(count + 1.0));
+    double unset = pow(1.0 - 1.0 / block_bits, (double)num_hashes * count);
+    rate += weight * pow(1.0 - unset, (double)num_hashes);
+  }
+  return rate;
+}
+
+/// @brief Create a new, empty Bloom filter.
+/// @param expected_elements The number of elements the filter is sized for.
+/// @param false_positive_rate The desired chance, between 0 and 1, that a
+/// missing element is reported as possibly present once expected_elements have
+/// been added.
+/// @param element_size The result of sizeof(element); used by the batch
+/// functions.
+/// @param hash_fn The hash function, exactly as for lj_new_hashset. The same
+/// function can serve both.
+/// @param allocator The allocator to use.
+/// @return The new filter. If allocation failed, it has no blocks and must not
+/// be used.
+lj_bloom_filter_t lj_new_bloom_filter(size_t expected_elements,
+                                      double false_positive_rate,
+                                      size_t element_size,
+                                      size_t (*hash_fn)(void *),
+                                      lj_allocator_t *allocator) {
+  if (expected_elements == 0U) {
+    expected_elements = 1U;
+  }
+  if (false_positive_rate <= 0.0 || false_positive_rate >= 1.0) {
+    false_positive_rate = 0.01;
+  }
+  const double LN2 = 0.69314718055994530942;
+  // k is chosen for an ideal unblocked filter; blocking then only costs space
+  double ideal_bits = -log(false_positive_rate) / (LN2 * LN2);
+  size_t num_hashes = (size_t)(ideal_bits * LN2 + 0.5);
+  if (num_hashes < 1U) {
+    num_hashes = 1U;
+  } else if (num_hashes > 16U) {
+    num_hashes = 16U;
+  }
+  // blocking skews the load between blocks, and the skew hurts more the lower
+  // the target rate, so grow the space until the blocked estimate meets it;
+  // the estimate ignores an element repeating a bit, hence the margin
+  double bits_per_element = ideal_bits;
+  for (int step = 0; step < 200; step++) {
+    if (lji_bloom_blocked_rate(bits_per_element, num_hashes) <=
+        false_positive_rate * 0.9) {
+      break;
+    }
+    bits_per_element *= 1.02;
+  }
+  double num_bits = bits_per_element * (double)expected_elements;
+  size_t num_blocks = (size_t)(num_bits / LJ_BLOOM_BLOCK_BITS_K) + 1U;
+  return lji_bloom_filter_with_blocks(num_blocks, num_hashes, element_size,
+                                      hash_fn, allocator);
+}
+
+/// @brief Delete a Bloom filter and free its memory.
+/// @param filter The filter to delete.
+void lj_bloom_filter_delete(lj_bloom_filter_t *filter) {
+  lj_bitset_delete(&filter->bits);
+  filter->num_blocks = 0U;
+}
+
+/// @private
+uint64_t lji_bloom_mix(size_t hash) {
+  uint64_t mixed = (uint64_t)hash;
+  mixed ^= mixed >> 33;
+  mixed *= 0xFF51AFD7ED558CCDULL;
+  mixed ^= mixed >> 33;
+  mixed *= 0xC4CEB9FE1A85EC53ULL;
+  mixed ^= mixed >> 33;
+  return mixed;
+}
+
+/// @private
+uint64_t *lji_bloom_block(lj_bloom_filter_t *filter, uint64_t mixed) {
+  size_t block = (size_t)((mixed >> 32) % filter->num_blocks);
+  return filter->bits.words + block * (LJ_BLOOM_BLOCK_BITS_K / 64U);
+}
+
+/// @private
+/// Stream of bit positions inside a block. Each position takes
+/// LJI_BLOOM_PROBE_BITS_K fresh bits of a remixed word, so the positions are
+/// independent of each other; a stepped sequence would make many elements
+/// share whole patterns.
+typedef struct {
+  uint64_t state;
+  uint64_t bits;
+  unsigned int left;
+} lji_bloom_probe_t;
+
+/// @private
+lji_bloom_probe_t lji_bloom_probe_start(uint64_t mixed) {
+  lji_bloom_probe_t probe = {mixed, 0U, 0U};
+  return probe;
+}
+
+/// @private
+uint32_t lji_bloom_probe_next(lji_bloom_probe_t *probe) {
+  if (probe->left == 0U) {
+    probe->state += 0x9E3779B97F4A7C15ULL;
+    probe->bits = lji_bloom_mix((size_t)probe->state);
+    probe->left = 64U / LJI_BLOOM_PROBE_BITS_K;
+  }
+  uint32_t bit = (uint32_t)(probe->bits & (LJ_BLOOM_BLOCK_BITS_K - 1U));
+  probe->bits >>= LJI_BLOOM_PROBE_BITS_K;
+  probe->left--;
+  return bit;
+}
+
+/// @brief Add an element to a Bloom filter.
+/// @param filter The filter in question.
+/// @param element The element to add.
+void lj_bloom_filter_add(lj_bloom_filter_t *filter, void *element) {
+  uint64_t mixed = lji_bloom_mix(filter->hash_fn(element));
+  uint64_t *block = lji_bloom_block(filter, mixed);
+  lji_bloom_probe_t probe = lji_bloom_probe_start(mixed);
+  for (size_t i = 0; i < filter->num_hashes; i++) {
+    uint32_t bit = lji_bloom_probe_next(&probe);
+    block[bit / 64U] |= (uint64_t)1U << (bit % 64U);
+  }
+}
+
+/// @brief Check if an element might be in a Bloom filter.
+/// @param filter The filter in question.
+/// @param element The element to look for.
+/// @return A bool; if false, the element was definitely never added. If true,
+/// it probably was.
+bool lj_bloom_filter_may_contain(lj_bloom_filter_t *filter, void *element) {
+  uint64_t mixed = lji_bloom_mix(filter->hash_fn(element));
+  uint64_t *block = lji_bloom_block(filter, mixed);
+  lji_bloom_probe_t probe = lji_bloom_probe_start(mixed);
+  for (size_t i = 0; i < filter->num_hashes; i++) {
+    uint32_t bit = lji_bloom_probe_next(&probe);
+    if (((block[bit / 64U] >> (bit % 64U)) & 1U) == 0U) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// @brief Add several elements to a Bloom filter.
+/// @param filter The filter in question.
+/// @param elements Pointer to count contiguous elements.
+/// @param count The number of elements.
+void lj_bloom_filter_add_n(lj_bloom_filter_t *filter, void *elements,
+                           size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    lj_bloom_filter_add(filter, (char *)elements + i * filter->element_size);
+  }
+}
+
+/// @brief Check several elements against a Bloom filter at once. The hashes
+/// of a small group are computed before any block is read, so the cache misses
+/// for the group overlap instead of happening one after another.
+/// @param filter The filter in question.
+/// @param elements Pointer to count contiguous elements.
+/// @param count The number of elements.
+/// @param out Pointer to count bools, each replaced with the result of
+/// lj_bloom_filter_may_contain for the matching element.
+/// @return The number of elements that might be present.
+size_t lj_bloom_filter_may_contain_n(lj_bloom_filter_t *filter, void *elements,
+                                     size_t count, bool *out) {
+  uint64_t mixed[16];
+  size_t hits = 0U;
+  for (size_t base = 0; base < count; base += 16U) {
+    size_t group = count - base < 16U ? count - base : 16U;
+    for (size_t i = 0; i < group; i++) {
+      mixed[i] = lji_bloom_mix(filter->hash_fn(
+          (char *)elements + (base + i) * filter->element_size));
+    }
+    for (size_t i = 0; i < group; i++) {
+      uint64_t *block = lji_bloom_block(filter, mixed[i]);
+      lji_bloom_probe_t probe = lji_bloom_probe_start(mixed[i]);
+      bool present = true;
+      for (size_t j = 0; j < filter->num_hashes && present; j++) {
+        uint32_t bit = lji_bloom_probe_next(&probe);
+        present = ((block[bit / 64U] >> (bit % 64U)) & 1U) != 0U;
+      }
+      out[base + i] = present;
+      hits += present;
+    }
+  }
+  return hits;
+}
+
+/// @brief Gets the number of bytes lj_bloom_filter_serialize writes.
+/// @param filter The filter in question.
+/// @return The serialized size in bytes.
+size_t lj_bloom_filter_serialized_size(lj_bloom_filter_t *filter) {
+  return 4U * sizeof(uint64_t) + filter->bits.num_words * sizeof(uint64_t);
+}
+
+/// @brief Write a Bloom filter into a flat buffer: a four-word header followed
+/// by the raw bits, all in native byte order.
+/// @param filter The filter in question.
+/// @param buffer Room for lj_bloom_filter_serialized_size(filter) bytes.
+void lj_bloom_filter_serialize(lj_bloom_filter_t *filter, void *buffer) {
+  uint64_t header[4] = {
+      LJI_BLOOM_MAGIC_K,
+      (uint64_t)filter->num_blocks,
+      (uint64_t)filter->num_hashes,
+      (uint64_t)filter->element_size,
+  };
+  memcpy(buffer, header, sizeof(header));
+  memcpy((char *)buffer + sizeof(header), filter->bits.words,
+         filter->bits.num_words * sizeof(uint64_t));
+}
+
+/// @brief Rebuild a Bloom filter from a buffer written by
+/// lj_bloom_filter_serialize on a machine with the same byte order.
+/// @param buffer The serialized filter.
+/// @param length The length of the buffer in bytes.
+/// @param hash_fn The hash function the filter was built with.
+/// @param allocator The allocator to use.
+/// @param out A pointer to a filter object to replace with the result. Any
+/// existing filter at this pointer will not be deleted by this.
+/// @return A bool; if false, the buffer was not a valid filter or memory ran
+/// out, and out is unchanged.
+bool lj_bloom_filter_deserialize(const void *buffer, size_t length,
+                                 size_t (*hash_fn)(void *),
+                                 lj_allocator_t *allocator,
+                                 lj_bloom_filter_t *out) {
+  uint64_t header[4];
+  if (length < sizeof(header)) {
+    return false;
+  }
+  memcpy(header, buffer, sizeof(header));
+  if (header[0] != LJI_BLOOM_MAGIC_K || header[1] == 0U || header[2] == 0U ||
+      header[1] > SIZE_MAX / LJ_BLOOM_BLOCK_BITS_K ||
+      length - sizeof(header) !=
+          header[1] * (LJ_BLOOM_BLOCK_BITS_K / 64U) * sizeof(uint64_t)) {
+    return false;
+  }
+  lj_bloom_filter_t filter =
+      lji_bloom_filter_with_blocks((size_t)header[1], (size_t)header[2],
+                                   (size_t)header[3], hash_fn, allocator);
+  if (filter.num_blocks == 0U) {
+    return false;
+  }
+  memcpy(filter.bits.words, (const char *)buffer + sizeof(header),
+         length - sizeof(header));
+  *out = filter;
+  return true;
+}
+
+#endif
@@ -0,0 +1,81 @@
+#include <libjune/collections/bloom.h>
+#include <libjune/unit.h>
+#include <stdio.h>
+
+static size_t hash_int(void *element) { return (size_t)*(int *)element; }
+
+static char *test_no_false_negatives(void) {
+  lj_bloom_filter_t filter = lj_new_bloom_filter(
+      10000, 0.01, sizeof(int), &hash_int, &lj_default_allocator);
+  for (int i = 0; i < 10000; i++) {
+    lj_bloom_filter_add(&filter, &i);
+  }
+  for (int i = 0; i < 10000; i++) {
+    lj_assert(lj_bloom_filter_may_contain(&filter, &i),
+              "added elements should always be reported");
+  }
+  int false_positives = 0;
+  for (int i = 10000; i < 110000; i++) {
+    false_positives += lj_bloom_filter_may_contain(&filter, &i);
+  }
+  lj_assert(false_positives < 1150,
+            "the false positive rate should be near what was asked for");
+  lj_bloom_filter_delete(&filter);
+  return 0;
+}
+
+static char *test_low_target_rate(void) {
+  lj_bloom_filter_t filter = lj_new_bloom_filter(
+      100000, 0.001, sizeof(int), &hash_int, &lj_default_allocator);
+  for (int i = 0; i < 100000; i++) {
+    lj_bloom_filter_add(&filter, &i);
+  }
+  int false_positives = 0;
+  for (int i = 100000; i < 1100000; i++) {
+    false_positives += lj_bloom_filter_may_contain(&filter, &i);
+  }
+  lj_assert(false_positives < 1150,
+            "low target rates should not be overshot as blocking worsens");
+  lj_bloom_filter_delete(&filter);
+  return 0;
+}
+
+static char *test_batches_and_serialization(void) {
+  lj_bloom_filter_t filter = lj_new_bloom_filter(
+      1000, 0.001, sizeof(int), &hash_int, &lj_default_allocator);
+  int elements[40];
+  bool results[40];
+  for (int i = 0; i < 40; i++) {
+    elements[i] = i * 7;
+  }
+  lj_bloom_filter_add_n(&filter, elements, 20);
+  lj_assert(lj_bloom_filter_may_contain_n(&filter, elements, 20, results) == 20,
+            "every added element should be reported by the batch query");
+  size_t length = lj_bloom_filter_serialized_size(&filter);
+  char *buffer = (char *)malloc(length);
+  lj_bloom_filter_serialize(&filter, buffer);
+  lj_bloom_filter_t copy;
+  lj_assert(!lj_bloom_filter_deserialize(buffer, length - 1, &hash_int,
+                                         &lj_default_allocator, &copy),
+            "a truncated buffer should be rejected");
+  lj_assert(lj_bloom_filter_deserialize(buffer, length, &hash_int,
+                                        &lj_default_allocator, &copy),
+            "a serialized filter should load");
+  bool copied[40];
+  lj_bloom_filter_may_contain_n(&filter, elements, 40, results);
+  lj_bloom_filter_may_contain_n(&copy, elements, 40, copied);
+  lj_assert(memcmp(results, copied, sizeof(results)) == 0,
+            "a loaded filter should answer like the original");
+  free(buffer);
+  lj_bloom_filter_delete(&copy);
+  lj_bloom_filter_delete(&filter);
+  return 0;
+}
+
+int main(const int argc, const char **argv) {
+  lj_run_test(test_no_false_negatives);
+  lj_run_test(test_low_target_rate);
+  lj_run_test(test_batches_and_serialization);
+  lj_finish_tests();
+  return 0;
+}
@@ -0,0 +1,790 @@
+/// @file libjune/collections/btree.h
+
+#ifndef LIBJUNE_COLLECTIONS_BTREE_H
+#define LIBJUNE_COLLECTIONS_BTREE_H
+
+#include <libjune/collections/vector.h>
+#include <libjune/memory.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/// @brief Target size of a B-tree node in bytes: sixteen cache lines, so a
+/// binary search inside a node touches only a handful of lines and the tree
+/// stays shallow.
+#define LJ_BTREE_NODE_SIZE_K (16U * LJ_CACHE_LINE_SIZE_K)
+
+/// @private
+#define LJI_BTREE_CHUNK_NODES_K 64U
+
+/// @private
+/// Followed in memory by the keys, then the values (leaves) or children
+/// (inner nodes).
+typedef struct lji_btree_node_t {
+  struct lji_btree_node_t *next;
+  uint32_t count;
+  uint32_t leaf;
+} lji_btree_node_t;
+
+/// @brief Ordered map from fixed-size keys to fixed-size values, stored as a
+/// B+-tree. All entries live in the leaves, which are chained in key order so
+/// range scans walk memory sequentially. Nodes come from chunks of the tree's
+/// allocator and are recycled through a free list. With a value size of 0 it
+/// is an ordered set.
+typedef struct {
+  lj_allocator_t *allocator;
+  size_t key_size;
+  size_t value_size;
+  int (*compare_fn)(const void *, const void *);
+  size_t leaf_capacity;
+  size_t inner_capacity;
+  size_t values_offset;
+  size_t children_offset;
+  size_t node_size;
+  lji_btree_node_t *root;
+  size_t count;
+  lji_btree_node_t *free_nodes;
+  char *chunk_cursor;
+  size_t chunk_remaining;
+  lj_vector_t chunks;
+  char *scratch;
+} lj_btree_t;
+
+/// @brief Outcome of adding an entry to a B-tree.
+typedef enum {
+  LJ_BTREE_INSERTED,
+  LJ_BTREE_REPLACED,
+  LJ_BTREE_FAILED,
+} lj_btree_status_t;
+
+/// @brief Position in a B-tree, used to walk entries in key order.
+typedef struct {
+  lj_btree_t *tree;
+  lji_btree_node_t *leaf;
+  size_t index;
+} lj_btree_iter_t;
+
+/// @private
+size_t lji_btree_align(size_t offset) {
+  size_t word = sizeof(uint64_t);
+  return (offset + word - 1U) / word * word;
+}
+
+/// @private
+/// Takes a node from the current chunk, allocating a new chunk if it is used
+/// up.
+lji_btree_node_t *lji_btree_carve_node(lj_btree_t *tree) {
+  if (tree->chunk_remaining == 0U) {
+    char *chunk = (char *)lj_allocate(
+        tree->allocator, tree->node_size * LJI_BTREE_CHUNK_NODES_K);
+    if (chunk == NULL) {
+      return NULL;
+    }
+    if (!lj_vector_push_back(&tree->chunks, &chunk)) {
+      lj_deallocate(tree->allocator, chunk);
+      return NULL;
+    }
+    tree->chunk_cursor = chunk;
+    tree->chunk_remaining = LJI_BTREE_CHUNK_NODES_K;
+  }
+  lji_btree_node_t *node = (lji_btree_node_t *)tree->chunk_cursor;
+  tree->chunk_cursor += tree->node_size;
+  tree->chunk_remaining--;
+  return node;
+}
+
+/// @private
+lji_btree_node_t *lji_btree_new_node(lj_btree_t *tree, bool leaf) {
+  lji_btree_node_t *node = tree->free_nodes;
+  if (node != NULL) {
+    tree->free_nodes = node->next;
+  } else {
+    node = lji_btree_carve_node(tree);
+    if (node == NULL) {
+      return NULL;
+    }
+  }
+  node->next = NULL;
+  node->count = 0U;
+  node->leaf = leaf;
+  return node;
+}
+
+/// @private
+void lji_btree_free_node(lj_btree_t *tree, lji_btree_node_t *node) {
+  node->next = tree->free_nodes;
+  tree->free_nodes = node;
+}
+
+/// @private
+/// Makes sure the free list holds at least needed nodes, so that many calls to
+/// lji_btree_new_node cannot fail.
+bool lji_btree_reserve_nodes(lj_btree_t *tree, size_t needed) {
+  size_t have = 0U;
+  for (lji_btree_node_t *node = tree->free_nodes;
+       node != NULL && have < needed; node = node->next) {
+    have++;
+  }
+  for (; have < needed; have++) {
+    lji_btree_node_t *node = lji_btree_carve_node(tree);
+    if (node == NULL) {
+      return false;
+    }
+    lji_btree_free_node(tree, node);
+  }
+  return true;
+}
+
+/// @private
+char *lji_btree_key(lj_btree_t *tree, lji_btree_node_t *node, size_t ind) {
+  return (char *)node + sizeof(lji_btree_node_t) + ind * tree->key_size;
+}
+
+/// @private
+char *lji_btree_value(lj_btree_t *tree, lji_btree_node_t *node, size_t ind) {
+  return (char *)node + tree->values_offset + ind * tree->value_size;
+}
+
+/// @private
+lji_btree_node_t **lji_btree_children(lj_btree_t *tree,
+                                      lji_btree_node_t *node) {
+  return (lji_btree_node_t **)((char *)node + tree->children_offset);
+}
+
+/// @brief Create a new, empty B-tree.
+/// @param key_size The result of sizeof(key).
+/// @param value_size The result of sizeof(value), or 0 for a set.
+/// @param compare_fn Compares two keys like qsort(3) does. If NULL, keys are
+/// int64_t values compared directly, which skips the indirect call on every
+/// step of a search; key_size must then be sizeof(int64_t).
+/// @param allocator The allocator to take node memory from.
+/// @return The new tree. If allocation failed, its root is NULL and it must
+/// not be used.
+lj_btree_t lj_new_btree(size_t key_size, size_t value_size,
+                        int (*compare_fn)(const void *, const void *),
+                        lj_allocator_t *allocator) {
+  size_t header = sizeof(lji_btree_node_t);
+  size_t pointer = sizeof(lji_btree_node_t *);
+  size_t room = LJ_BTREE_NODE_SIZE_K - header - sizeof(uint64_t);
+  size_t leaf_capacity = room / (key_size + value_size);
+  size_t inner_capacity = (room - pointer) / (key_size + pointer);
+  // very large entries would leave too few per node for the tree to balance
+  if (leaf_capacity < 4U) {
+    leaf_capacity = 4U;
+  }
+  if (inner_capacity < 4U) {
+    inner_capacity = 4U;
+  }
+  lj_btree_t tree = {
+      .allocator = allocator,
+      .key_size = key_size,
+      .value_size = value_size,
+      .compare_fn = compare_fn,
+      .leaf_capacity = leaf_capacity,
+      .inner_capacity = inner_capacity,
+      .values_offset = lji_btree_align(header + leaf_capacity * key_size),
+      .children_offset = lji_btree_align(header + inner_capacity * key_size),
+      .count = 0U,
+      .free_nodes = NULL,
+      .chunk_cursor = NULL,
+      .chunk_remaining = 0U,
+      .chunks = lj_new_vector(sizeof(char *), allocator),
+      .scratch = (char *)lj_allocate(allocator, 2U * key_size),
+  };
+  size_t leaf_end = tree.values_offset + leaf_capacity * value_size;
+  size_t inner_end = tree.children_offset + (inner_capacity + 1U) * pointer;
+  size_t node_size = leaf_end > inner_end ? leaf_end : inner_end;
+  tree.node_size = (node_size + LJ_CACHE_LINE_SIZE_K - 1U) /
+                   LJ_CACHE_LINE_SIZE_K * LJ_CACHE_LINE_SIZE_K;
+  tree.root = tree.scratch == NULL ? NULL : lji_btree_new_node(&tree, true);
+  return tree;
+}
+
+/// @brief Delete a B-tree and free its memory.
+/// @param tree The tree to delete.
+void lj_btree_delete(lj_btree_t *tree) {
+  char *chunk;
+  while (lj_vector_pop_back(&tree->chunks, &chunk)) {
+    lj_deallocate(tree->allocator, chunk);
+  }
+  lj_delete_vector(&tree->chunks);
+  lj_deallocate(tree->allocator, tree->scratch);
+  tree->root = tree->free_nodes = NULL;
+  tree->scratch = NULL;
+  tree->count = 0U;
+}
+
+/// @brief Gets the number of entries in a B-tree.
+/// @param tree The tree in question.
+/// @return The number of entries.
+size_t lj_btree_size(lj_btree_t *tree) { return tree->count; }
+
+/// @private
+int lji_btree_compare(lj_btree_t *tree, const void *a, const void *b) {
+  if (tree->compare_fn == NULL) {
+    int64_t x, y;
+    memcpy(&x, a, sizeof(int64_t));
+    memcpy(&y, b, sizeof(int64_t));
+    return (x > y) - (x < y);
+  }
+  return tree->compare_fn(a, b);
+}
+
+/// @private
+/// Index of the first key in the node that is not less than key.
+size_t lji_btree_lower_bound(lj_btree_t *tree, lji_btree_node_t *node,
+                             const void *key) {
+  size_t low = 0U;
+  size_t high = node->count;
+  if (tree->compare_fn == NULL) {
+    // keys start right after the header, so they are 8-byte aligned
+    const int64_t *keys = (const int64_t *)lji_btree_key(tree, node, 0U);
+    int64_t target;
+    memcpy(&target, key, sizeof(int64_t));
+    while (low < high) {
+      size_t mid = low + (high - low) / 2U;
+      if (keys[mid] < target) {
+        low = mid + 1U;
+      } else {
+        high = mid;
+      }
+    }
+    return low;
+  }
+  while (low < high) {
+    size_t mid = low + (high - low) / 2U;
+    if (tree->compare_fn(lji_btree_key(tree, node, mid), key) < 0) {
+      low = mid + 1U;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/// @private
+/// Index of the child of an inner node whose subtree could hold key.
+size_t lji_btree_child_index(lj_btree_t *tree, lji_btree_node_t *node,
+                             const void *key) {
+  size_t ind = lji_btree_lower_bound(tree, node, key);
+  if (ind < node->count &&
+      lji_btree_compare(tree, lji_btree_key(tree, node, ind), key) == 0) {
+    ind++;
+  }
+  return ind;
+}
+
+/// @private
+lji_btree_node_t *lji_btree_find_leaf(lj_btree_t *tree, const void *key) {
+  lji_btree_node_t *node = tree->root;
+  while (!node->leaf) {
+    node = lji_btree_children(tree, node)[lji_btree_child_index(tree, node,
+                                                                key)];
+  }
+  return node;
+}
+
+/// @brief Look up a key in a B-tree.
+/// @param tree The tree in question.
+/// @param key The key to look for.
+/// @param out Pointer to a value that will be replaced by the key's value. If
+/// NULL is passed in, only presence is checked.
+/// @return A bool indicating if the key was present.
+bool lj_btree_get(lj_btree_t *tree, const void *key, void *out) {
+  lji_btree_node_t *leaf = lji_btree_find_leaf(tree, key);
+  size_t ind = lji_btree_lower_bound(tree, leaf, key);
+  if (ind == leaf->count ||
+      lji_btree_compare(tree, lji_btree_key(tree, leaf, ind), key) != 0) {
+    return false;
+  }
+  if (out != NULL && tree->value_size > 0U) {
+    memcpy(out, lji_btree_value(tree, leaf, ind), tree->value_size);
+  }
+  return true;
+}
+
+/// @private
+void lji_btree_leaf_put(lj_btree_t *tree, lji_btree_node_t *leaf, size_t ind,
+                        const void *key, const void *value) {
+  size_t after = leaf->count - ind;
+  memmove(lji_btree_key(tree, leaf, ind + 1U), lji_btree_key(tree, leaf, ind),
+          after * tree->key_size);
+  memcpy(lji_btree_key(tree, leaf, ind), key, tree->key_size);
+  if (tree->value_size > 0U) {
+    memmove(lji_btree_value(tree, leaf, ind + 1U),
+            lji_btree_value(tree, leaf, ind), after * tree->value_size);
+    memcpy(lji_btree_value(tree, leaf, ind), value, tree->value_size);
+  }
+  leaf->count++;
+}
+
+/// @private
+void lji_btree_inner_put(lj_btree_t *tree, lji_btree_node_t *node, size_t ind,
+                         const void *key, lji_btree_node_t *right) {
+  lji_btree_node_t **children = lji_btree_children(tree, node);
+  memmove(lji_btree_key(tree, node, ind + 1U), lji_btree_key(tree, node, ind),
+          (node->count - ind) * tree->key_size);
+  memcpy(lji_btree_key(tree, node, ind), key, tree->key_size);
+  memmove(children + ind + 2U, children + ind + 1U,
+          (node->count - ind) * sizeof(lji_btree_node_t *));
+  children[ind + 1U] = right;
+  node->count++;
+}
+
+/// @private
+/// Number of nodes an insert of key could allocate: one for every full node at
+/// the bottom of its path, plus a new root if they reach all the way up.
+size_t lji_btree_split_nodes(lj_btree_t *tree, const void *key) {
+  size_t full = 0U;
+  size_t depth = 0U;
+  lji_btree_node_t *node = tree->root;
+  for (;;) {
+    size_t capacity = node->leaf ? tree->leaf_capacity : tree->inner_capacity;
+    full = node->count < capacity ? 0U : full + 1U;
+    depth++;
+    if (node->leaf) {
+      break;
+    }
+    node = lji_btree_children(tree, node)[lji_btree_child_index(tree, node,
+                                                                key)];
+  }
+  return full == depth ? full + 1U : full;
+}
+
+/// @private
+/// Inserts below node. If node had to split, returns the new right sibling and
+/// leaves the key separating them in tree->scratch. The caller must have
+/// reserved the nodes a split needs.
+lji_btree_node_t *lji_btree_insert_into(lj_btree_t *tree,
+                                        lji_btree_node_t *node,
+                                        const void *key, const void *value,
+                                        bool *existed) {
+  if (node->leaf) {
+    size_t ind = lji_btree_lower_bound(tree, node, key);
+    if (ind < node->count &&
+        lji_btree_compare(tree, lji_btree_key(tree, node, ind), key) == 0) {
+      if (tree->value_size > 0U) {
+        memcpy(lji_btree_value(tree, node, ind), value, tree->value_size);
+      }
+      *existed = true;
+      return NULL;
+    }
+    if (node->count < tree->leaf_capacity) {
+      lji_btree_leaf_put(tree, node, ind, key, value);
+      return NULL;
+    }
+    lji_btree_node_t *right = lji_btree_new_node(tree, true);
+    size_t keep = (node->count + 1U) / 2U;
+    right->count = node->count - keep;
+    memcpy(lji_btree_key(tree, right, 0U), lji_btree_key(tree, node, keep),
+           right->count * tree->key_size);
+    memcpy(lji_btree_value(tree, right, 0U), lji_btree_value(tree, node, keep),
+           right->count * tree->value_size);
+    node->count = keep;
+    right->next = node->next;
+    node->next = right;
+    if (ind <= keep) {
+      lji_btree_leaf_put(tree, node, ind, key, value);
+    } else {
+      lji_btree_leaf_put(tree, right, ind - keep, key, value);
+    }
+    memcpy(tree->scratch, lji_btree_key(tree, right, 0U), tree->key_size);
+    return right;
+  }
+  size_t ind = lji_btree_child_index(tree, node, key);
+  lji_btree_node_t *split = lji_btree_insert_into(
+      tree, lji_btree_children(tree, node)[ind], key, value, existed);
+  if (split == NULL) {
+    return NULL;
+  }
+  if (node->count < tree->inner_capacity) {
+    lji_btree_inner_put(tree, node, ind, tree->scratch, split);
+    return NULL;
+  }
+  lji_btree_node_t *right = lji_btree_new_node(tree, false);
+  // the middle key moves up; park it while the child's key is still needed
+  size_t mid = node->count / 2U;
+  char *up_key = tree->scratch + tree->key_size;
+  memcpy(up_key, lji_btree_key(tree, node, mid), tree->key_size);
+  right->count = node->count - mid - 1U;
+  memcpy(lji_btree_key(tree, right, 0U), lji_btree_key(tree, node, mid + 1U),
+         right->count * tree->key_size);
+  memcpy(lji_btree_children(tree, right),
+         lji_btree_children(tree, node) + mid + 1U,
+         (right->count + 1U) * sizeof(lji_btree_node_t *));
+  node->count = mid;
+  if (ind <= mid) {
+    lji_btree_inner_put(tree, node, ind, tree->scratch, split);
+  } else {
+    lji_btree_inner_put(tree, right, ind - mid - 1U, tree->scratch, split);
+  }
+  memcpy(tree->scratch, up_key, tree->key_size);
+  return right;
+}
+
+/// @brief Add an entry to a B-tree, replacing the value if the key is already
+/// present.
+/// @param tree The tree in question.
+/// @param key The key to add.
+/// @param value The value to store with it; ignored for sets.
+/// @return LJ_BTREE_INSERTED or LJ_BTREE_REPLACED depending on whether the key
+/// was already present, or LJ_BTREE_FAILED if the allocator could not provide
+/// the nodes a split needed, in which case the tree is unchanged.
+lj_btree_status_t lj_btree_insert(lj_btree_t *tree, const void *key,
+                                  const void *value) {
+  // take every node the split could need up front so it never stops halfway
+  if (!lji_btree_reserve_nodes(tree, lji_btree_split_nodes(tree, key))) {
+    return LJ_BTREE_FAILED;
+  }
+  bool existed = false;
+  lji_btree_node_t *split =
+      lji_btree_insert_into(tree, tree->root, key, value, &existed);
+  if (split != NULL) {
+    lji_btree_node_t *root = lji_btree_new_node(tree, false);
+    memcpy(lji_btree_key(tree, root, 0U), tree->scratch, tree->key_size);
+    lji_btree_children(tree, root)[0] = tree->root;
+    lji_btree_children(tree, root)[1] = split;
+    root->count = 1U;
+    tree->root = root;
+  }
+  if (existed) {
+    return LJ_BTREE_REPLACED;
+  }
+  tree->count++;
+  return LJ_BTREE_INSERTED;
+}
+
+/// @private
+size_t lji_btree_min_count(lj_btree_t *tree, lji_btree_node_t *node) {
+  return node->leaf ? tree->leaf_capacity / 2U
+                    : (tree->inner_capacity - 1U) / 2U;
+}
+
+/// @private
+/// Moves one entry from the child at ind + 1 to the end of the child at ind.
+void lji_btree_shift_left(lj_btree_t *tree, lji_btree_node_t *parent,
+                          size_t ind) {
+  lji_btree_node_t **children = lji_btree_children(tree, parent);
+  lji_btree_node_t *left = children[ind];
+  lji_btree_node_t *right = children[ind + 1U];
+  char *separator = lji_btree_key(tree, parent, ind);
+  if (left->leaf) {
+    memcpy(lji_btree_key(tree, left, left->count),
+           lji_btree_key(tree, right, 0U), tree->key_size);
+    memcpy(lji_btree_value(tree, left, left->count),
+           lji_btree_value(tree, right, 0U), tree->value_size);
+    memmove(lji_btree_key(tree, right, 0U), lji_btree_key(tree, right, 1U),
+            (right->count - 1U) * tree->key_size);
+    memmove(lji_btree_value(tree, right, 0U), lji_btree_value(tree, right, 1U),
+            (right->count - 1U) * tree->value_size);
+    memcpy(separator, lji_btree_key(tree, right, 0U), tree->key_size);
+  } else {
+    lji_btree_node_t **right_children = lji_btree_children(tree, right);
+    memcpy(lji_btree_key(tree, left, left->count), separator, tree->key_size);
+    lji_btree_children(tree, left)[left->count + 1U] = right_children[0];
+    memcpy(separator, lji_btree_key(tree, right, 0U), tree->key_size);
+    memmove(lji_btree_key(tree, right, 0U), lji_btree_key(tree, right, 1U),
+            (right->count - 1U) * tree->key_size);
+    memmove(right_children, right_children + 1U,
+            right->count * sizeof(lji_btree_node_t *));
+  }
+  left->count++;
+  right->count--;
+}
+
+/// @private
+/// Moves one entry from the end of the child at ind to the child at ind + 1.
+void lji_btree_shift_right(lj_btree_t *tree, lji_btree_node_t *parent,
+                           size_t ind) {
+  lji_btree_node_t **children = lji_btree_children(tree, parent);
+  lji_btree_node_t *left = children[ind];
+  lji_btree_node_t *right = children[ind + 1U];
+  char *separator = lji_btree_key(tree, parent, ind);
+  if (left->leaf) {
+    lji_btree_leaf_put(tree, right, 0U,
+                       lji_btree_key(tree, left, left->count - 1U),
+                       lji_btree_value(tree, left, left->count - 1U));
+    memcpy(separator, lji_btree_key(tree, right, 0U), tree->key_size);
+  } else {
+    lji_btree_node_t **right_children = lji_btree_children(tree, right);
+    memmove(lji_btree_key(tree, right, 1U), lji_btree_key(tree, right, 0U),
+            right->count * tree->key_size);
+    memmove(right_children + 1U, right_children,
+            (right->count + 1U) * sizeof(lji_btree_node_t *));
+    memcpy(lji_btree_key(tree, right, 0U), separator, tree->key_size);
+    right_children[0] = lji_btree_children(tree, left)[left->count];
+    memcpy(separator, lji_btree_key(tree, left, left->count - 1U),
+           tree->key_size);
+    right->count++;
+  }
+  left->count--;
+}
+
+/// @private
+/// Folds the child at ind + 1 into the child at ind and drops it.
+void lji_btree_merge(lj_btree_t *tree, lji_btree_node_t *parent, size_t ind) {
+  lji_btree_node_t **children = lji_btree_children(tree, parent);
+  lji_btree_node_t *left = children[ind];
+  lji_btree_node_t *right = children[ind + 1U];
+  if (left->leaf) {
+    memcpy(lji_btree_key(tree, left, left->count),
+           lji_btree_key(tree, right, 0U), right->count * tree->key_size);
+    memcpy(lji_btree_value(tree, left, left->count),
+           lji_btree_value(tree, right, 0U), right->count * tree->value_size);
+    left->count += right->count;
+    left->next = right->next;
+  } else {
+    memcpy(lji_btree_key(tree, left, left->count),
+           lji_btree_key(tree, parent, ind), tree->key_size);
+    memcpy(lji_btree_key(tree, left, left->count + 1U),
+           lji_btree_key(tree, right, 0U), right->count * tree->key_size);
+    memcpy(lji_btree_children(tree, left) + left->count + 1U,
+           lji_btree_children(tree, right),
+           (right->count + 1U) * sizeof(lji_btree_node_t *));
+    left->count += right->count + 1U;
+  }
+  memmove(lji_btree_key(tree, parent, ind),
+          lji_btree_key(tree, parent, ind + 1U),
+          (parent->count - ind - 1U) * tree->key_size);
+  memmove(children + ind + 1U, children + ind + 2U,
+          (parent->count - ind - 1U) * sizeof(lji_btree_node_t *));
+  parent->count--;
+  lji_btree_free_node(tree, right);
+}
+
+/// @private
+bool lji_btree_remove_from(lj_btree_t *tree, lji_btree_node_t *node,
+                           const void *key, void *out) {
+  if (node->leaf) {
+    size_t ind = lji_btree_lower_bound(tree, node, key);
+    if (ind == node->count ||
+        lji_btree_compare(tree, lji_btree_key(tree, node, ind), key) != 0) {
+      return false;
+    }
+    if (out != NULL && tree->value_size > 0U) {
+      memcpy(out, lji_btree_value(tree, node, ind), tree->value_size);
+    }
+    size_t after = node->count - ind - 1U;
+    memmove(lji_btree_key(tree, node, ind), lji_btree_key(tree, node, ind + 1U),
+            after * tree->key_size);
+    memmove(lji_btree_value(tree, node, ind),
+            lji_btree_value(tree, node, ind + 1U), after * tree->value_size);
+    node->count--;
+    return true;
+  }
+  size_t ind = lji_btree_child_index(tree, node, key);
+  lji_btree_node_t **children = lji_btree_children(tree, node);
+  lji_btree_node_t *child = children[ind];
+  if (!lji_btree_remove_from(tree, child, key, out)) {
+    return false;
+  }
+  if (child->count >= lji_btree_min_count(tree, child)) {
+    return true;
+  }
+  // borrow from a sibling with entries to spare, otherwise merge with one
+  if (ind > 0U &&
+      children[ind - 1U]->count > lji_btree_min_count(tree, child)) {
+    lji_btree_shift_right(tree, node, ind - 1U);
+  } else if (ind < node->count &&
+             children[ind + 1U]->count > lji_btree_min_count(tree, child)) {
+    lji_btree_shift_left(tree, node, ind);
+  } else if (ind > 0U) {
+    lji_btree_merge(tree, node, ind - 1U);
+  } else {
+    lji_btree_merge(tree, node, ind);
+  }
+  return true;
+}
+
+/// @brief Remove an entry from a B-tree.
+/// @param tree The tree in question.
+/// @param key The key to remove.
+/// @param out Pointer to a value that will be replaced by the removed value. If
+/// NULL is passed in, the value is just dropped.
+/// @return A bool; if false, the key was not present and the tree is
+/// unchanged.
+bool lj_btree_remove(lj_btree_t *tree, const void *key, void *out) {
+  if (!lji_btree_remove_from(tree, tree->root, key, out)) {
+    return false;
+  }
+  if (!tree->root->leaf && tree->root->count == 0U) {
+    lji_btree_node_t *old_root = tree->root;
+    tree->root = lji_btree_children(tree, old_root)[0];
+    lji_btree_free_node(tree, old_root);
+  }
+  tree->count--;
+  return true;
+}
+
+/// @private
+/// Builds one level of inner nodes over the nodes below, spreading children
+/// evenly so no node starts under its minimum.
+bool lji_btree_build_level(lj_btree_t *tree, lj_vector_t *nodes,
+                           lj_vector_t *first_keys) {
+  size_t below = lj_vector_size(nodes);
+  size_t fanout = tree->inner_capacity + 1U;
+  size_t count = (below + fanout - 1U) / fanout;
+  lji_btree_node_t **children = (lji_btree_node_t **)nodes->content_start;
+  lj_vector_t level =
+      lj_new_vector(sizeof(lji_btree_node_t *), tree->allocator);
+  lj_vector_t level_keys = lj_new_vector(tree->key_size, tree->allocator);
+  size_t taken = 0U;
+  for (size_t i = 0; i < count; i++) {
+    size_t share = below / count + (i < below % count ? 1U : 0U);
+    lji_btree_node_t *node = lji_btree_new_node(tree, false);
+    if (node == NULL || !lj_vector_push_back(&level, &node) ||
+        !lj_vector_push_back(&level_keys, first_keys->content_start +
+                                              taken * tree->key_size)) {
+      lj_delete_vector(&level);
+      lj_delete_vector(&level_keys);
+      return false;
+    }
+    memcpy(lji_btree_children(tree, node), children + taken,
+           share * sizeof(lji_btree_node_t *));
+    memcpy(lji_btree_key(tree, node, 0U),
+           first_keys->content_start + (taken + 1U) * tree->key_size,
+           (share - 1U) * tree->key_size);
+    node->count = share - 1U;
+    taken += share;
+  }
+  lj_delete_vector(nodes);
+  lj_delete_vector(first_keys);
+  *nodes = level;
+  *first_keys = level_keys;
+  return true;
+}
+
+/// @brief Fill an empty B-tree from entries already sorted by key, packing
+/// the leaves and building the levels above them directly. Much faster than
+/// inserting one at a time.
+/// @param tree The tree in question. It must be empty.
+/// @param keys Pointer to count contiguous keys in strictly increasing order.
+/// @param values Pointer to count contiguous values; ignored for sets.
+/// @param count The number of entries.
+/// @return A bool; if false, the tree was not empty, the keys were out of
+/// order, or memory ran out, and the tree is empty.
+bool lj_btree_bulk_load(lj_btree_t *tree, const void *keys, const void *values,
+                        size_t count) {
+  if (tree->count != 0U) {
+    return false;
+  }
+  const char *key_bytes = (const char *)keys;
+  for (size_t i = 1; i < count; i++) {
+    if (lji_btree_compare(tree, key_bytes + (i - 1U) * tree->key_size,
+                          key_bytes + i * tree->key_size) >= 0) {
+      return false;
+    }
+  }
+  if (count == 0U) {
+    return true;
+  }
+  size_t num_leaves = (count + tree->leaf_capacity - 1U) / tree->leaf_capacity;
+  lj_vector_t nodes =
+      lj_new_vector(sizeof(lji_btree_node_t *), tree->allocator);
+  lj_vector_t first_keys = lj_new_vector(tree->key_size, tree->allocator);
+  lji_btree_node_t *empty_root = tree->root;
+  lji_btree_node_t *previous = NULL;
+  size_t taken = 0U;
+  bool ok = true;
+  for (size_t i = 0; i < num_leaves && ok; i++) {
+    size_t share = count / num_leaves + (i < count % num_leaves ? 1U : 0U);
+    lji_btree_node_t *leaf =
+        i == 0U ? empty_root : lji_btree_new_node(tree, true);
+    if (leaf == NULL) {
+      ok = false;
+      break;
+    }
+    memcpy(lji_btree_key(tree, leaf, 0U), key_bytes + taken * tree->key_size,
+           share * tree->key_size);
+    if (tree->value_size > 0U) {
+      memcpy(lji_btree_value(tree, leaf, 0U),
+             (const char *)values + taken * tree->value_size,
+             share * tree->value_size);
+    }
+    leaf->count = share;
+    if (previous != NULL) {
+      previous->next = leaf;
+    }
+    previous = leaf;
+    if (!lj_vector_push_back(&nodes, &leaf) ||
+        !lj_vector_push_back(&first_keys, lji_btree_key(tree, leaf, 0U))) {
+      ok = false;
+      break;
+    }
+    taken += share;
+  }
+  while (ok && lj_vector_size(&nodes) > 1U) {
+    ok = lji_btree_build_level(tree, &nodes, &first_keys);
+  }
+  if (ok) {
+    tree->root = *(lji_btree_node_t **)nodes.content_start;
+    tree->count = count;
+  } else {
+    // start over rather than leave a half-built tree, keeping the first chunk
+    // so the fresh root cannot fail to allocate
+    char *chunk;
+    while (lj_vector_size(&tree->chunks) > 1U) {
+      lj_vector_pop_back(&tree->chunks, &chunk);
+      lj_deallocate(tree->allocator, chunk);
+    }
+    tree->free_nodes = NULL;
+    tree->chunk_cursor = *(char **)tree->chunks.content_start;
+    tree->chunk_remaining = LJI_BTREE_CHUNK_NODES_K;
+    tree->root = lji_btree_new_node(tree, true);
+  }
+  lj_delete_vector(&nodes);
+  lj_delete_vector(&first_keys);
+  return ok;
+}
+
+/// @brief Find the first entry whose key is not less than a given key. Walk
+/// from there with lj_btree_iter_next to scan a range.
+/// @param tree The tree in question.
+/// @param key The lower bound of the scan, or NULL to start at the smallest
+/// key.
+/// @return An iterator positioned at that entry.
+lj_btree_iter_t lj_btree_seek(lj_btree_t *tree, const void *key) {
+  lji_btree_node_t *leaf = tree->root;
+  size_t ind = 0U;
+  if (key == NULL) {
+    while (!leaf->leaf) {
+      leaf = lji_btree_children(tree, leaf)[0];
+    }
+  } else {
+    leaf = lji_btree_find_leaf(tree, key);
+    ind = lji_btree_lower_bound(tree, leaf, key);
+  }
+  return (lj_btree_iter_t){.tree = tree, .leaf = leaf, .index = ind};
+}
+
+/// @brief Take the entry at an iterator and move it forward. Changing the tree
+/// invalidates its iterators.
+/// @param iter The iterator in question.
+/// @param key_out Pointer to a key that will be replaced by the entry's key,
+/// or NULL.
+/// @param value_out Pointer to a value that will be replaced by the entry's
+/// value, or NULL.
+/// @return A bool; if false, the iterator was past the last entry.
+bool lj_btree_iter_next(lj_btree_iter_t *iter, void *key_out,
+                        void *value_out) {
+  lj_btree_t *tree = iter->tree;
+  while (iter->leaf != NULL && iter->index == iter->leaf->count) {
+    iter->leaf = iter->leaf->next;
+    iter->index = 0U;
+  }
+  if (iter->leaf == NULL) {
+    return false;
+  }
+  if (key_out != NULL) {
+    memcpy(key_out, lji_btree_key(tree, iter->leaf, iter->index),
+           tree->key_size);
+  }
+  if (value_out != NULL && tree->value_size > 0U) {
+    memcpy(value_out, lji_btree_value(tree, iter->leaf, iter->index),
+           tree->value_size);
+  }
+  iter->index++;
+  return true;
+}
+
+#endif
@@ -0,0 +1,235 @@
+#include <libjune/collections/btree.h>
+#include <libjune/unit.h>
+#include <stdio.h>
+
+typedef struct {
+  char name[56];
+  int64_t id;
+} wide_key_t;
+
+static int compare_wide(const void *a, const void *b) {
+  int64_t x = ((const wide_key_t *)a)->id;
+  int64_t y = ((const wide_key_t *)b)->id;
+  return (x > y) - (x < y);
+}
+
+static uint64_t next_random(uint64_t *seed) {
+  *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+  return *seed >> 33;
+}
+
+static char *test_against_reference(void) {
+  // wide keys keep the nodes small, so a few thousand entries reach several
+  // levels and exercise every split, borrow and merge
+  lj_btree_t tree = lj_new_btree(sizeof(wide_key_t), sizeof(int), &compare_wide,
+                                 &lj_default_allocator);
+  static bool present[4096];
+  memset(present, 0, sizeof(present));
+  size_t expected = 0;
+  uint64_t seed = 99;
+  for (int round = 0; round < 60000; round++) {
+    wide_key_t key = {.id = (int64_t)(next_random(&seed) % 4096)};
+    int value = (int)key.id * 3;
+    if (next_random(&seed) % 3 != 0) {
+      lj_btree_status_t status = lj_btree_insert(&tree, &key, &value);
+      lj_assert(status == (present[key.id] ? LJ_BTREE_REPLACED
+                                           : LJ_BTREE_INSERTED),
+                "insert should report whether the key was there");
+      expected += !present[key.id];
+      present[key.id] = true;
+    } else {
+      int removed = -1;
+      lj_assert(lj_btree_remove(&tree, &key, &removed) == present[key.id],
+                "remove should report whether the key was there");
+      lj_assert(!present[key.id] || removed == value,
+                "remove should hand back the value");
+      expected -= present[key.id];
+      present[key.id] = false;
+    }
+  }
+  lj_assert(lj_btree_size(&tree) == expected, "the size should track changes");
+  lj_btree_iter_t iter = lj_btree_seek(&tree, NULL);
+  wide_key_t key;
+  int value;
+  int64_t last = -1;
+  size_t seen = 0;
+  while (lj_btree_iter_next(&iter, &key, &value)) {
+    lj_assert(key.id > last && present[key.id] && value == key.id * 3,
+              "iteration should visit exactly the present keys in order");
+    last = key.id;
+    seen++;
+  }
+  lj_assert(seen == expected, "iteration should visit every entry");
+  for (int64_t id = 0; id < 4096; id++) {
+    key.id = id;
+    lj_btree_remove(&tree, &key, NULL);
+  }
+  lj_assert(lj_btree_size(&tree) == 0 && tree.root->leaf,
+            "removing everything should collapse the tree to one leaf");
+  lj_btree_delete(&tree);
+  return 0;
+}
+
+static char *test_bulk_load_and_range(void) {
+  lj_btree_t tree = lj_new_btree(sizeof(int64_t), sizeof(int64_t), NULL,
+                                 &lj_default_allocator);
+  static int64_t keys[100000];
+  static int64_t values[100000];
+  for (int64_t i = 0; i < 100000; i++) {
+    keys[i] = i * 2;
+    values[i] = -i;
+  }
+  int64_t unsorted[3] = {1, 3, 2};
+  lj_assert(!lj_btree_bulk_load(&tree, unsorted, values, 3),
+            "out of order input should be rejected");
+  lj_assert(lj_btree_bulk_load(&tree, keys, values, 100000),
+            "sorted input should load");
+  lj_assert(!lj_btree_bulk_load(&tree, keys, values, 10),
+            "a tree that is not empty should not bulk load");
+  int64_t key = 1001;
+  int64_t value;
+  lj_assert(!lj_btree_get(&tree, &key, NULL), "odd keys should be missing");
+  key = 1000;
+  lj_assert(lj_btree_get(&tree, &key, &value) && value == -500,
+            "loaded keys should be found");
+  // scan [1001, 2001)
+  key = 1001;
+  lj_btree_iter_t iter = lj_btree_seek(&tree, &key);
+  int64_t expect = 1002;
+  while (lj_btree_iter_next(&iter, &key, NULL) && key < 2001) {
+    lj_assert(key == expect, "a range scan should step through the keys");
+    expect += 2;
+  }
+  lj_assert(expect == 2002, "a range scan should stop at its upper bound");
+  for (int64_t i = 0; i < 100000; i += 2) {
+    key = i * 2 + 1;
+    lj_btree_insert(&tree, &key, &key);
+    key = i * 2;
+    lj_btree_remove(&tree, &key, NULL);
+  }
+  lj_assert(lj_btree_size(&tree) == 100000,
+            "a bulk loaded tree should take changes");
+  iter = lj_btree_seek(&tree, NULL);
+  int64_t last = -1;
+  while (lj_btree_iter_next(&iter, &key, NULL)) {
+    lj_assert(key > last, "keys should stay in order");
+    last = key;
+  }
+  lj_btree_delete(&tree);
+  return 0;
+}
+
+static char *test_set(void) {
+  lj_btree_t set =
+      lj_new_btree(sizeof(int64_t), 0, NULL, &lj_default_allocator);
+  for (int64_t i = 500; i > 0; i--) {
+    lj_btree_insert(&set, &i, NULL);
+  }
+  int64_t key = 250;
+  lj_assert(lj_btree_get(&set, &key, NULL), "a set should hold its keys");
+  lj_assert(lj_btree_insert(&set, &key, NULL) == LJ_BTREE_REPLACED,
+            "a repeat should be reported");
+  lj_assert(lj_btree_size(&set) == 500, "a repeat should not be counted");
+  lj_btree_delete(&set);
+  return 0;
+}
+
+static void *budget_allocate(void *state, size_t volume) {
+  size_t *budget = (size_t *)state;
+  if (*budget == 0U) {
+    return NULL;
+  }
+  (*budget)--;
+  return malloc(volume);
+}
+
+static void budget_deallocate(void *state, void *memory) { free(memory); }
+
+static char *test_allocation_failure(void) {
+  size_t budget = 8U;
+  lj_allocator_t allocator = {
+      .allocate_fn = &budget_allocate,
+      .deallocate_fn = &budget_deallocate,
+      .state = &budget,
+      .reallocate_fn = NULL,
+  };
+  lj_btree_t tree =
+      lj_new_btree(sizeof(wide_key_t), sizeof(int), &compare_wide, &allocator);
+  int64_t inserted = 0;
+  for (;; inserted++) {
+    wide_key_t key = {.id = inserted};
+    int value = (int)inserted;
+    lj_btree_status_t status = lj_btree_insert(&tree, &key, &value);
+    if (status == LJ_BTREE_FAILED) {
+      break;
+    }
+    lj_assert(status == LJ_BTREE_INSERTED, "new keys should be inserted");
+  }
+  lj_assert(inserted > 0 && lj_btree_size(&tree) == (size_t)inserted,
+            "a failed insert should not be counted");
+  for (int64_t id = 0; id < inserted; id++) {
+    wide_key_t key = {.id = id};
+    lj_assert(lj_btree_get(&tree, &key, NULL),
+              "a failed insert should not lose earlier keys");
+  }
+  budget = SIZE_MAX;
+  for (int64_t id = inserted; id < inserted + 5000; id++) {
+    wide_key_t key = {.id = id};
+    int value = (int)id;
+    lj_assert(lj_btree_insert(&tree, &key, &value) == LJ_BTREE_INSERTED,
+              "inserts should work again once memory is available");
+  }
+  lj_btree_iter_t iter = lj_btree_seek(&tree, NULL);
+  wide_key_t key;
+  int64_t expect = 0;
+  while (lj_btree_iter_next(&iter, &key, NULL)) {
+    lj_assert(key.id == expect, "every key should be present once in order");
+    expect++;
+  }
+  lj_assert(expect == inserted + 5000 &&
+                lj_btree_size(&tree) == (size_t)expect,
+            "the size should match the entries");
+  lj_btree_delete(&tree);
+
+  // fail a bulk load at every allocation it makes in turn
+  static int64_t keys[20000];
+  for (int64_t i = 0; i < 20000; i++) {
+    keys[i] = i;
+  }
+  bool loaded = false;
+  for (size_t limit = 0U; !loaded; limit++) {
+    budget = SIZE_MAX;
+    lj_btree_t bulk =
+        lj_new_btree(sizeof(int64_t), sizeof(int64_t), NULL, &allocator);
+    budget = limit;
+    loaded = lj_btree_bulk_load(&bulk, keys, keys, 20000);
+    budget = SIZE_MAX;
+    if (!loaded) {
+      lj_btree_iter_t empty = lj_btree_seek(&bulk, NULL);
+      lj_assert(lj_btree_size(&bulk) == 0 &&
+                    !lj_btree_iter_next(&empty, NULL, NULL),
+                "a failed bulk load should leave the tree empty");
+      int64_t key = 42;
+      lj_assert(lj_btree_insert(&bulk, &key, &key) == LJ_BTREE_INSERTED &&
+                    lj_btree_get(&bulk, &key, NULL),
+                "a tree should still work after a failed bulk load");
+    } else {
+      int64_t key = 19999;
+      int64_t value;
+      lj_assert(lj_btree_size(&bulk) == 20000 &&
+                    lj_btree_get(&bulk, &key, &value) && value == 19999,
+                "a bulk load with enough memory should load everything");
+    }
+    lj_btree_delete(&bulk);
+  }
+  return 0;
+}
+
+int main(const int argc, const char **argv) {
+  lj_run_test(test_against_reference);
+  lj_run_test(test_bulk_load_and_range);
+  lj_run_test(test_set);
+  lj_run_test(test_allocation_failure);
+  lj_finish_tests();
+  return 0;
+}
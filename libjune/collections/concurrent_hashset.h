@@ -0,0 +1,498 @@
+/// @file libjune/collections/concurrent_hashset.h
+
+#ifndef LIBJUNE_COLLECTIONS_CONCURRENT_HASHSET_H
+#define LIBJUNE_COLLECTIONS_CONCURRENT_HASHSET_H
+
+#if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 201112L ||               \
+    defined(__STDC_NO_ATOMICS__) || defined(__STDC_NO_THREADS__)
+#error "libjune/collections/concurrent_hashset.h requires C11 atomics and threads"
+#endif
+
+#include <libjune/memory.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <threads.h>
+
+/// @private
+#define LJI_CONCURRENT_EMPTY_K 0U
+/// @private
+#define LJI_CONCURRENT_TOMBSTONE_K 1U
+/// @private
+#define LJI_CONCURRENT_INITIAL_CAPACITY_K 16U
+
+/// @private
+/// One open-addressed table. Tags say whether a slot is empty, a tombstone or
+/// holds an element with that (mixed) hash; elements follow the tags. Each
+/// element is kept as whole atomic words, zero padded, so readers can look at
+/// it while a writer replaces it.
+typedef struct lji_concurrent_table_t {
+  size_t capacity;
+  size_t words;
+  struct lji_concurrent_table_t *next_retired;
+  atomic_size_t *tags;
+  atomic_size_t *elements;
+} lji_concurrent_table_t;
+
+/// @private
+typedef struct {
+  mtx_t lock;
+  atomic_size_t sequence;
+  _Atomic(lji_concurrent_table_t *) table;
+  atomic_size_t epoch;
+  atomic_size_t readers[2];
+  size_t count;
+  size_t tombstones;
+  lji_concurrent_table_t *retired;
+  lji_concurrent_table_t *draining;
+  char padding[LJ_CACHE_LINE_SIZE_K];
+} lji_concurrent_shard_t;
+
+/// @brief Outcome of adding an element to a concurrent hash set.
+typedef enum {
+  LJ_CONCURRENT_HASHSET_ADDED,
+  LJ_CONCURRENT_HASHSET_PRESENT,
+  LJ_CONCURRENT_HASHSET_FAILED,
+} lj_concurrent_hashset_status_t;
+
+/// @brief Hash set that many threads can use at once. Elements are spread over
+/// shards by their hash. Writers to a shard take its lock; readers never lock
+/// and instead retry if a writer touched the shard while they looked.
+///
+/// This is a seqlock. A reader may look at an element while a writer in the
+/// same shard is replacing it; every element word is read and written with
+/// relaxed atomics so that is not a data race, and the sequence check throws
+/// away any result pieced together from two different elements.
+///
+/// Growing or cleaning a shard swaps in a new table, but readers may still be
+/// probing the old one. Readers count themselves in and out of a shard under
+/// one of two alternating epochs, and later writes free an old table once
+/// every reader that could have reached it has left, so memory stays bounded
+/// under steady adds and removes without any help from the caller.
+typedef struct {
+  size_t element_size;
+  size_t num_shards;
+  lji_concurrent_shard_t *shards;
+  size_t (*hash_fn)(void *);
+  lj_allocator_t *allocator;
+} lj_concurrent_hashset_t;
+
+/// @private
+size_t lji_concurrent_mix(size_t hash) {
+  hash ^= hash >> 16;
+  hash *= (size_t)0x9E3779B97F4A7C15ULL;
+  hash ^= hash >> 15;
+  return hash;
+}
+
+/// @private
+size_t lji_concurrent_tag(size_t mixed) {
+  return mixed > LJI_CONCURRENT_TOMBSTONE_K ? mixed : mixed + 2U;
+}
+
+/// @private
+/// Word ind of an element, with the bytes past its end as zero.
+size_t lji_concurrent_word(const void *element, size_t element_size,
+                           size_t ind) {
+  size_t word = 0U;
+  size_t offset = ind * sizeof(size_t);
+  size_t length = element_size - offset < sizeof(size_t)
+                      ? element_size - offset
+                      : sizeof(size_t);
+  memcpy(&word, (const char *)element + offset, length);
+  return word;
+}
+
+/// @private
+lji_concurrent_table_t *lji_concurrent_table_new(size_t capacity,
+                                                 size_t element_size,
+                                                 lj_allocator_t *allocator) {
+  size_t header = sizeof(lji_concurrent_table_t);
+  header += _Alignof(atomic_size_t) - header % _Alignof(atomic_size_t);
+  size_t words = (element_size + sizeof(size_t) - 1U) / sizeof(size_t);
+  char *block = (char *)lj_allocate(
+      allocator, header + capacity * (1U + words) * sizeof(atomic_size_t));
+  if (block == NULL) {
+    return NULL;
+  }
+  lji_concurrent_table_t *table = (lji_concurrent_table_t *)block;
+  table->capacity = capacity;
+  table->words = words;
+  table->next_retired = NULL;
+  table->tags = (atomic_size_t *)(block + header);
+  table->elements = table->tags + capacity;
+  for (size_t i = 0; i < capacity; i++) {
+    atomic_init(&table->tags[i], LJI_CONCURRENT_EMPTY_K);
+  }
+  for (size_t i = 0; i < capacity * words; i++) {
+    atomic_init(&table->elements[i], 0U);
+  }
+  return table;
+}
+
+/// @private
+/// Copies an element into a slot. Only called with the shard lock held.
+void lji_concurrent_table_store(lji_concurrent_table_t *table, size_t slot,
+                                const void *element, size_t element_size) {
+  atomic_size_t *words = table->elements + slot * table->words;
+  for (size_t i = 0; i < table->words; i++) {
+    atomic_store_explicit(&words[i],
+                          lji_concurrent_word(element, element_size, i),
+                          memory_order_relaxed);
+  }
+}
+
+/// @private
+/// Returns the slot holding element, or capacity if it is absent. Lock-free
+/// readers call this too; what they see may mix two writes, which is why they
+/// check the shard sequence afterwards.
+size_t lji_concurrent_table_find(lji_concurrent_table_t *table, size_t tag,
+                                 size_t start, const void *element,
+                                 size_t element_size) {
+  size_t mask = table->capacity - 1U;
+  for (size_t probe = 0; probe < table->capacity; probe++) {
+    size_t slot = (start + probe) & mask;
+    size_t seen = atomic_load_explicit(&table->tags[slot], memory_order_acquire);
+    if (seen == LJI_CONCURRENT_EMPTY_K) {
+      return table->capacity;
+    }
+    if (seen != tag) {
+      continue;
+    }
+    atomic_size_t *words = table->elements + slot * table->words;
+    size_t i = 0U;
+    while (i < table->words &&
+           atomic_load_explicit(&words[i], memory_order_relaxed) ==
+               lji_concurrent_word(element, element_size, i)) {
+      i++;
+    }
+    if (i == table->words) {
+      return slot;
+    }
+  }
+  return table->capacity;
+}
+
+/// @brief Create a new concurrent hash set.
+/// @param element_size The result of sizeof(element).
+/// @param num_shards The number of independently locked shards. Rounded up to
+/// a power of two; a few times the number of writing threads works well.
+/// @param hash_fn The hash function, exactly as for lj_new_hashset. It is
+/// called from many threads at once.
+/// @param allocator The allocator to use. Writers allocate from it while
+/// holding a shard lock, so it must be safe to call from several threads.
+/// @return The new set. If allocation failed, its shards are NULL and it must
+/// not be used.
+lj_concurrent_hashset_t lj_new_concurrent_hashset(size_t element_size,
+                                                  size_t num_shards,
+                                                  size_t (*hash_fn)(void *),
+                                                  lj_allocator_t *allocator) {
+  size_t rounded = 1U;
+  while (rounded < num_shards) {
+    rounded <<= 1;
+  }
+  lj_concurrent_hashset_t set = {
+      .element_size = element_size,
+      .num_shards = rounded,
+      .shards = NULL,
+      .hash_fn = hash_fn,
+      .allocator = allocator,
+  };
+  lji_concurrent_shard_t *shards = (lji_concurrent_shard_t *)lj_allocate(
+      allocator, rounded * sizeof(lji_concurrent_shard_t));
+  if (shards == NULL) {
+    return set;
+  }
+  for (size_t i = 0; i < rounded; i++) {
+    lji_concurrent_table_t *table = lji_concurrent_table_new(
+        LJI_CONCURRENT_INITIAL_CAPACITY_K, element_size, allocator);
+    if (table == NULL || mtx_init(&shards[i].lock, mtx_plain) != thrd_success) {
+      for (size_t j = 0; j < i; j++) {
+        mtx_destroy(&shards[j].lock);
+        lj_deallocate(allocator, atomic_load(&shards[j].table));
+      }
+      lj_deallocate(allocator, table);
+      lj_deallocate(allocator, shards);
+      return set;
+    }
+    atomic_init(&shards[i].sequence, 0U);
+    atomic_init(&shards[i].table, table);
+    shards[i].count = 0U;
+    shards[i].tombstones = 0U;
+    atomic_init(&shards[i].epoch, 0U);
+    atomic_init(&shards[i].readers[0], 0U);
+    atomic_init(&shards[i].readers[1], 0U);
+    shards[i].retired = NULL;
+    shards[i].draining = NULL;
+  }
+  set.shards = shards;
+  return set;
+}
+
+/// @private
+void lji_concurrent_free_tables(lj_concurrent_hashset_t *set,
+                                lji_concurrent_table_t *table) {
+  while (table != NULL) {
+    lji_concurrent_table_t *next = table->next_retired;
+    lj_deallocate(set->allocator, table);
+    table = next;
+  }
+}
+
+/// @brief Delete a concurrent hash set and free its memory, including any
+/// old tables still waiting to be freed. No other thread may be using it.
+/// @param set The set to delete.
+void lj_concurrent_hashset_delete(lj_concurrent_hashset_t *set) {
+  for (size_t i = 0; i < set->num_shards; i++) {
+    lji_concurrent_shard_t *shard = &set->shards[i];
+    lji_concurrent_free_tables(set, shard->retired);
+    lji_concurrent_free_tables(set, shard->draining);
+    lj_deallocate(set->allocator, atomic_load(&shard->table));
+    mtx_destroy(&shard->lock);
+  }
+  lj_deallocate(set->allocator, set->shards);
+  set->shards = NULL;
+}
+
+/// @private
+/// Counts a reader into the shard under its current epoch and returns the
+/// counter to count it back out of. The epoch is checked again after counting
+/// in, so a writer that has moved on to the next epoch either sees this reader
+/// or this reader sees every table that writer swapped in.
+atomic_size_t *lji_concurrent_read_enter(lji_concurrent_shard_t *shard) {
+  for (;;) {
+    size_t epoch = atomic_load(&shard->epoch);
+    atomic_size_t *readers = &shard->readers[epoch & 1U];
+    atomic_fetch_add(readers, 1U);
+    if (atomic_load(&shard->epoch) == epoch) {
+      return readers;
+    }
+    atomic_fetch_sub(readers, 1U);
+  }
+}
+
+/// @private
+/// Frees old tables no reader can still reach, then starts a new epoch for
+/// the ones retired since. A table in draining was swapped out before the
+/// current epoch began, so only readers counted under the previous epoch can
+/// hold it; and the epoch only moves on once those from the one before have
+/// left. Only called with the shard lock held.
+void lji_concurrent_shard_collect(lj_concurrent_hashset_t *set,
+                                  lji_concurrent_shard_t *shard) {
+  if (shard->retired == NULL && shard->draining == NULL) {
+    return;
+  }
+  size_t epoch = atomic_load(&shard->epoch);
+  if (atomic_load(&shard->readers[(epoch - 1U) & 1U]) != 0U) {
+    return;
+  }
+  lji_concurrent_free_tables(set, shard->draining);
+  shard->draining = shard->retired;
+  shard->retired = NULL;
+  if (shard->draining != NULL) {
+    atomic_store(&shard->epoch, epoch + 1U);
+  }
+}
+
+/// @brief Free old tables left behind by resizes as far as readers allow.
+/// Writers already do this as they go, so this is only needed to give memory
+/// back promptly, for example after a burst of writes. Safe to call at any
+/// time.
+/// @param set The set in question.
+void lj_concurrent_hashset_reclaim(lj_concurrent_hashset_t *set) {
+  for (size_t i = 0; i < set->num_shards; i++) {
+    lji_concurrent_shard_t *shard = &set->shards[i];
+    mtx_lock(&shard->lock);
+    // once to retire into the next epoch, once more to free if nobody reads
+    lji_concurrent_shard_collect(set, shard);
+    lji_concurrent_shard_collect(set, shard);
+    mtx_unlock(&shard->lock);
+  }
+}
+
+/// @brief Check if an element is in a concurrent hash set. Never takes a lock,
+/// so any number of threads can call this alongside writers.
+/// @param set The set in question.
+/// @param element The element to look for.
+/// @return A bool indicating if the element is in the set.
+bool lj_concurrent_hashset_contains(lj_concurrent_hashset_t *set,
+                                    void *element) {
+  size_t mixed = lji_concurrent_mix(set->hash_fn(element));
+  lji_concurrent_shard_t *shard = &set->shards[mixed & (set->num_shards - 1U)];
+  size_t tag = lji_concurrent_tag(mixed);
+  atomic_size_t *readers = lji_concurrent_read_enter(shard);
+  for (;;) {
+    size_t before = atomic_load_explicit(&shard->sequence, memory_order_acquire);
+    if (before & 1U) {
+      thrd_yield();
+      continue;
+    }
+    lji_concurrent_table_t *table =
+        atomic_load_explicit(&shard->table, memory_order_acquire);
+    bool found =
+        lji_concurrent_table_find(table, tag, tag / set->num_shards, element,
+                                  set->element_size) != table->capacity;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&shard->sequence, memory_order_relaxed) ==
+        before) {
+      atomic_fetch_sub(readers, 1U);
+      return found;
+    }
+  }
+}
+
+/// @private
+void lji_concurrent_write_begin(lji_concurrent_shard_t *shard) {
+  size_t sequence =
+      atomic_load_explicit(&shard->sequence, memory_order_relaxed);
+  atomic_store_explicit(&shard->sequence, sequence + 1U, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+/// @private
+void lji_concurrent_write_end(lji_concurrent_shard_t *shard) {
+  size_t sequence =
+      atomic_load_explicit(&shard->sequence, memory_order_relaxed);
+  atomic_store_explicit(&shard->sequence, sequence + 1U, memory_order_release);
+}
+
+/// @private
+/// Rebuilds a shard's table without tombstones, doubling it if it is getting
+/// full. The old table is retired rather than freed, since readers may still
+/// be probing it; lji_concurrent_shard_collect frees it later.
+bool lji_concurrent_shard_resize(lj_concurrent_hashset_t *set,
+                                 lji_concurrent_shard_t *shard) {
+  lji_concurrent_table_t *old =
+      atomic_load_explicit(&shard->table, memory_order_relaxed);
+  size_t capacity = old->capacity;
+  if ((shard->count + 1U) * 2U > capacity) {
+    capacity *= 2U;
+  }
+  lji_concurrent_table_t *table =
+      lji_concurrent_table_new(capacity, set->element_size, set->allocator);
+  if (table == NULL) {
+    return false;
+  }
+  for (size_t i = 0; i < old->capacity; i++) {
+    size_t tag = atomic_load_explicit(&old->tags[i], memory_order_relaxed);
+    if (tag <= LJI_CONCURRENT_TOMBSTONE_K) {
+      continue;
+    }
+    size_t slot = (tag / set->num_shards) & (capacity - 1U);
+    while (atomic_load_explicit(&table->tags[slot], memory_order_relaxed) !=
+           LJI_CONCURRENT_EMPTY_K) {
+      slot = (slot + 1U) & (capacity - 1U);
+    }
+    // the new table is not published yet, so these stores race with nothing
+    for (size_t w = 0; w < old->words; w++) {
+      atomic_store_explicit(
+          &table->elements[slot * table->words + w],
+          atomic_load_explicit(&old->elements[i * old->words + w],
+                               memory_order_relaxed),
+          memory_order_relaxed);
+    }
+    atomic_store_explicit(&table->tags[slot], tag, memory_order_relaxed);
+  }
+  lji_concurrent_write_begin(shard);
+  atomic_store_explicit(&shard->table, table, memory_order_release);
+  lji_concurrent_write_end(shard);
+  shard->tombstones = 0U;
+  old->next_retired = shard->retired;
+  shard->retired = old;
+  return true;
+}
+
+/// @brief Add an element to a concurrent hash set.
+/// @param set The set in question.
+/// @param element The element to add.
+/// @return LJ_CONCURRENT_HASHSET_ADDED or LJ_CONCURRENT_HASHSET_PRESENT
+/// depending on whether the element was already there, or
+/// LJ_CONCURRENT_HASHSET_FAILED if its shard was full and the allocator could
+/// not provide a bigger table, in which case the set is unchanged.
+lj_concurrent_hashset_status_t
+lj_concurrent_hashset_add(lj_concurrent_hashset_t *set, void *element) {
+  size_t mixed = lji_concurrent_mix(set->hash_fn(element));
+  lji_concurrent_shard_t *shard = &set->shards[mixed & (set->num_shards - 1U)];
+  size_t tag = lji_concurrent_tag(mixed);
+  size_t start = tag / set->num_shards;
+  mtx_lock(&shard->lock);
+  lji_concurrent_table_t *table =
+      atomic_load_explicit(&shard->table, memory_order_relaxed);
+  if (lji_concurrent_table_find(table, tag, start, element,
+                                set->element_size) != table->capacity) {
+    mtx_unlock(&shard->lock);
+    return LJ_CONCURRENT_HASHSET_PRESENT;
+  }
+  if ((shard->count + shard->tombstones + 1U) * 4U > table->capacity * 3U &&
+      lji_concurrent_shard_resize(set, shard)) {
+    table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+  }
+  lj_concurrent_hashset_status_t status = LJ_CONCURRENT_HASHSET_FAILED;
+  size_t mask = table->capacity - 1U;
+  for (size_t probe = 0; probe < table->capacity; probe++) {
+    size_t slot = (start + probe) & mask;
+    size_t seen = atomic_load_explicit(&table->tags[slot], memory_order_relaxed);
+    if (seen <= LJI_CONCURRENT_TOMBSTONE_K) {
+      lji_concurrent_write_begin(shard);
+      lji_concurrent_table_store(table, slot, element, set->element_size);
+      atomic_store_explicit(&table->tags[slot], tag, memory_order_release);
+      lji_concurrent_write_end(shard);
+      if (seen == LJI_CONCURRENT_TOMBSTONE_K) {
+        shard->tombstones--;
+      }
+      shard->count++;
+      status = LJ_CONCURRENT_HASHSET_ADDED;
+      break;
+    }
+  }
+  lji_concurrent_shard_collect(set, shard);
+  mtx_unlock(&shard->lock);
+  return status;
+}
+
+/// @brief Remove an element from a concurrent hash set.
+/// @param set The set in question.
+/// @param element The element to remove.
+/// @return A bool indicating whether the element was present and thus if the
+/// set was changed.
+bool lj_concurrent_hashset_remove(lj_concurrent_hashset_t *set,
+                                  void *element) {
+  size_t mixed = lji_concurrent_mix(set->hash_fn(element));
+  lji_concurrent_shard_t *shard = &set->shards[mixed & (set->num_shards - 1U)];
+  mtx_lock(&shard->lock);
+  lji_concurrent_table_t *table =
+      atomic_load_explicit(&shard->table, memory_order_relaxed);
+  size_t tag = lji_concurrent_tag(mixed);
+  size_t slot = lji_concurrent_table_find(table, tag, tag / set->num_shards,
+                                          element, set->element_size);
+  if (slot == table->capacity) {
+    mtx_unlock(&shard->lock);
+    return false;
+  }
+  lji_concurrent_write_begin(shard);
+  atomic_store_explicit(&table->tags[slot], LJI_CONCURRENT_TOMBSTONE_K,
+                        memory_order_release);
+  lji_concurrent_write_end(shard);
+  shard->count--;
+  shard->tombstones++;
+  lji_concurrent_shard_collect(set, shard);
+  mtx_unlock(&shard->lock);
+  return true;
+}
+
+/// @brief Gets the number of elements in a concurrent hash set. Locks every
+/// shard in turn, so the answer is only exact if no other thread is writing.
+/// @param set The set in question.
+/// @return The number of elements.
+size_t lj_concurrent_hashset_size(lj_concurrent_hashset_t *set) {
+  size_t total = 0U;
+  for (size_t i = 0; i < set->num_shards; i++) {
+    mtx_lock(&set->shards[i].lock);
+    total += set->shards[i].count;
+    mtx_unlock(&set->shards[i].lock);
+  }
+  return total;
+}
+
+#endif
@@ -0,0 +1,227 @@
+#include <libjune/collections/concurrent_hashset.h>
+#include <libjune/unit.h>
+#include <stdint.h>
+#include <stdio.h>
+
+static size_t hash_int(void *element) { return (size_t)*(int *)element; }
+
+static char *test_add_contains_remove(void) {
+  lj_concurrent_hashset_t set =
+      lj_new_concurrent_hashset(sizeof(int), 4, &hash_int, &lj_default_allocator);
+  for (int i = 0; i < 5000; i++) {
+    lj_assert(lj_concurrent_hashset_add(&set, &i) ==
+                  LJ_CONCURRENT_HASHSET_ADDED,
+              "adding a new element should report it was added");
+  }
+  int again = 42;
+  lj_assert(lj_concurrent_hashset_add(&set, &again) ==
+                LJ_CONCURRENT_HASHSET_PRESENT,
+            "adding an existing element should report it was present");
+  lj_assert(lj_concurrent_hashset_size(&set) == 5000,
+            "duplicates should not be stored twice");
+  for (int i = 0; i < 5000; i += 2) {
+    lj_assert(lj_concurrent_hashset_remove(&set, &i),
+              "removing a present element should return true");
+  }
+  for (int i = 0; i < 5000; i++) {
+    lj_assert(lj_concurrent_hashset_contains(&set, &i) == (i % 2 == 1),
+              "only the elements not removed should remain");
+  }
+  int missing = -1;
+  lj_assert(!lj_concurrent_hashset_remove(&set, &missing),
+            "removing a missing element should return false");
+  lj_concurrent_hashset_delete(&set);
+  return 0;
+}
+
+typedef struct {
+  char bytes[13];
+} odd_t;
+
+static size_t hash_odd(void *element) {
+  size_t hash = 0;
+  for (int i = 0; i < 13; i++) {
+    hash = hash * 31 + (unsigned char)((odd_t *)element)->bytes[i];
+  }
+  return hash;
+}
+
+static char *test_odd_element_size(void) {
+  // 13 bytes spans two words with the last one only partly used
+  lj_concurrent_hashset_t set = lj_new_concurrent_hashset(
+      sizeof(odd_t), 2, &hash_odd, &lj_default_allocator);
+  odd_t element;
+  memset(&element, 'a', sizeof(element));
+  for (int i = 0; i < 300; i++) {
+    element.bytes[12] = (char)i;
+    element.bytes[0] = (char)(i / 256);
+    lj_concurrent_hashset_add(&set, &element);
+  }
+  element.bytes[0] = 0;
+  element.bytes[12] = 7;
+  lj_assert(lj_concurrent_hashset_contains(&set, &element),
+            "an added element should be found");
+  element.bytes[11] = 'b';
+  lj_assert(!lj_concurrent_hashset_contains(&set, &element),
+            "a difference in the last word should be noticed");
+  lj_concurrent_hashset_delete(&set);
+  return 0;
+}
+
+static void *budget_allocate(void *state, size_t volume) {
+  size_t *budget = (size_t *)state;
+  if (*budget == 0U) {
+    return NULL;
+  }
+  (*budget)--;
+  return malloc(volume);
+}
+
+static void budget_deallocate(void *state, void *memory) { free(memory); }
+
+static char *test_full_shard(void) {
+  size_t budget = SIZE_MAX;
+  lj_allocator_t allocator = {
+      .allocate_fn = &budget_allocate,
+      .deallocate_fn = &budget_deallocate,
+      .state = &budget,
+      .reallocate_fn = NULL,
+  };
+  lj_concurrent_hashset_t set =
+      lj_new_concurrent_hashset(sizeof(int), 1, &hash_int, &allocator);
+  budget = 0U;
+  int added = 0;
+  while (lj_concurrent_hashset_add(&set, &added) ==
+         LJ_CONCURRENT_HASHSET_ADDED) {
+    added++;
+  }
+  lj_assert(added > 0 && !lj_concurrent_hashset_contains(&set, &added),
+            "an element that did not fit should not be in the set");
+  lj_assert(lj_concurrent_hashset_add(&set, &added) ==
+                LJ_CONCURRENT_HASHSET_FAILED,
+            "a full shard that cannot grow should report failure");
+  int first = 0;
+  lj_assert(lj_concurrent_hashset_add(&set, &first) ==
+                LJ_CONCURRENT_HASHSET_PRESENT,
+            "a full shard should still recognise its elements");
+  budget = SIZE_MAX;
+  lj_assert(lj_concurrent_hashset_add(&set, &added) ==
+                LJ_CONCURRENT_HASHSET_ADDED,
+            "the set should grow once memory is available");
+  lj_concurrent_hashset_delete(&set);
+  return 0;
+}
+
+#define READERS 4
+#define WRITTEN 200000
+
+static lj_concurrent_hashset_t shared_set;
+static atomic_int reader_failures;
+
+static int read_stable_half(void *arg) {
+  // odd elements are added before the readers start and never removed
+  for (int round = 0; round < 5; round++) {
+    for (int i = 1; i < 2000; i += 2) {
+      if (!lj_concurrent_hashset_contains(&shared_set, &i)) {
+        atomic_fetch_add(&reader_failures, 1);
+      }
+    }
+  }
+  return 0;
+}
+
+static char *test_readers_during_writes(void) {
+  shared_set =
+      lj_new_concurrent_hashset(sizeof(int), 8, &hash_int, &lj_default_allocator);
+  atomic_init(&reader_failures, 0);
+  for (int i = 1; i < 2000; i += 2) {
+    lj_concurrent_hashset_add(&shared_set, &i);
+  }
+  thrd_t readers[READERS];
+  for (int i = 0; i < READERS; i++) {
+    thrd_create(&readers[i], &read_stable_half, NULL);
+  }
+  for (int i = 2000; i < WRITTEN; i++) {
+    lj_concurrent_hashset_add(&shared_set, &i);
+    if (i % 3 == 0) {
+      lj_concurrent_hashset_remove(&shared_set, &i);
+    }
+  }
+  for (int i = 0; i < READERS; i++) {
+    thrd_join(readers[i], NULL);
+  }
+  lj_assert(atomic_load(&reader_failures) == 0,
+            "readers should see every element that was never removed");
+  lj_concurrent_hashset_reclaim(&shared_set);
+  lj_assert(lj_concurrent_hashset_size(&shared_set) ==
+                1000 + (WRITTEN - 2000) - (WRITTEN - 2000 + 2) / 3,
+            "resizing should not lose elements");
+  lj_concurrent_hashset_delete(&shared_set);
+  return 0;
+}
+
+static size_t pending_tables(lj_concurrent_hashset_t *set) {
+  size_t pending = 0;
+  for (size_t i = 0; i < set->num_shards; i++) {
+    lji_concurrent_table_t *lists[2] = {set->shards[i].retired,
+                                        set->shards[i].draining};
+    for (int j = 0; j < 2; j++) {
+      for (lji_concurrent_table_t *t = lists[j]; t != NULL;
+           t = t->next_retired) {
+        pending++;
+      }
+    }
+  }
+  return pending;
+}
+
+static atomic_bool churning;
+
+static int read_while_churning(void *arg) {
+  int probe = 0;
+  while (atomic_load(&churning)) {
+    lj_concurrent_hashset_contains(&shared_set, &probe);
+    probe = (probe + 1) % 64;
+  }
+  return 0;
+}
+
+static char *test_churn_frees_old_tables(void) {
+  // adding and removing elements rebuilds the table to clear tombstones every
+  // dozen or so writes, about 16000 times here; those used to pile up until
+  // reclaimed
+  shared_set =
+      lj_new_concurrent_hashset(sizeof(int), 1, &hash_int, &lj_default_allocator);
+  atomic_init(&churning, true);
+  thrd_t readers[READERS];
+  for (int i = 0; i < READERS; i++) {
+    thrd_create(&readers[i], &read_while_churning, NULL);
+  }
+  size_t most = 0;
+  for (int i = 0; i < 200000; i++) {
+    lj_concurrent_hashset_add(&shared_set, &i);
+    lj_concurrent_hashset_remove(&shared_set, &i);
+    size_t pending = pending_tables(&shared_set);
+    most = pending > most ? pending : most;
+  }
+  atomic_store(&churning, false);
+  for (int i = 0; i < READERS; i++) {
+    thrd_join(readers[i], NULL);
+  }
+  lj_assert(most < 4000, "old tables should be freed while readers run");
+  lj_concurrent_hashset_reclaim(&shared_set);
+  lj_assert(pending_tables(&shared_set) == 0,
+            "with no readers left every old table should be freed");
+  lj_concurrent_hashset_delete(&shared_set);
+  return 0;
+}
+
+int main(const int argc, const char **argv) {
+  lj_run_test(test_add_contains_remove);
+  lj_run_test(test_odd_element_size);
+  lj_run_test(test_full_shard);
+  lj_run_test(test_readers_during_writes);
+  lj_run_test(test_churn_frees_old_tables);
+  lj_finish_tests();
+  return 0;
+}
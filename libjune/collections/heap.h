@@ -0,0 +1,344 @@
+/// @file libjune/collections/heap.h
+
+#ifndef LIBJUNE_COLLECTIONS_HEAP_H
+#define LIBJUNE_COLLECTIONS_HEAP_H
+
+#include <libjune/collections/vector.h>
+#include <libjune/memory.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/// @brief Number of children per heap node. Four children keep a node's
+/// siblings in one or two cache lines and halve the tree depth.
+#define LJ_HEAP_ARITY_K 4U
+
+/// @brief Handle for an element in a heap. Handles of popped or removed
+/// elements are never mistaken for newer ones.
+typedef uint64_t lj_heap_handle_t;
+
+/// @brief Handle value that never refers to an element.
+#define LJ_HEAP_INVALID_HANDLE_K UINT64_MAX
+
+/// @private
+#define LJI_HEAP_NO_POSITION_K SIZE_MAX
+
+/// @private
+/// Where a handle's element sits in the heap, and how many times the slot has
+/// been reused so stale handles can be told apart.
+typedef struct {
+  size_t position;
+  uint32_t generation;
+} lji_heap_slot_t;
+
+/// @brief Priority queue of fixed-size elements, smallest first, stored as a
+/// 4-ary heap in one contiguous vector. Every element gets a handle that stays
+/// valid while it is in the heap and can be used to change its key or remove
+/// it.
+typedef struct {
+  lj_vector_t entries;
+  lj_vector_t slots;
+  lj_vector_t free_slots;
+  size_t element_size;
+  int (*compare_fn)(const void *, const void *);
+  char *scratch;
+  lj_allocator_t *allocator;
+} lj_heap_t;
+
+/// @private
+/// Each entry is its slot index followed by the element, padded so both stay
+/// aligned.
+size_t lji_heap_stride(size_t element_size) {
+  size_t word = sizeof(size_t);
+  return word + (element_size + word - 1U) / word * word;
+}
+
+/// @private
+char *lji_heap_entry(lj_heap_t *heap, size_t ind) {
+  return heap->entries.content_start + ind * heap->entries.element_size;
+}
+
+/// @private
+size_t lji_heap_entry_slot(const char *entry) {
+  size_t slot;
+  memcpy(&slot, entry, sizeof(size_t));
+  return slot;
+}
+
+/// @private
+int lji_heap_compare(lj_heap_t *heap, const char *a, const char *b) {
+  return heap->compare_fn(a + sizeof(size_t), b + sizeof(size_t));
+}
+
+/// @private
+lji_heap_slot_t *lji_heap_slots(lj_heap_t *heap) {
+  return (lji_heap_slot_t *)heap->slots.content_start;
+}
+
+/// @private
+/// Moves the entry in scratch up from the hole at ind, then drops it in.
+void lji_heap_sift_up(lj_heap_t *heap, size_t ind) {
+  size_t stride = heap->entries.element_size;
+  lji_heap_slot_t *slots = lji_heap_slots(heap);
+  while (ind > 0U) {
+    size_t parent = (ind - 1U) / LJ_HEAP_ARITY_K;
+    char *parent_entry = lji_heap_entry(heap, parent);
+    if (lji_heap_compare(heap, heap->scratch, parent_entry) >= 0) {
+      break;
+    }
+    memcpy(lji_heap_entry(heap, ind), parent_entry, stride);
+    slots[lji_heap_entry_slot(parent_entry)].position = ind;
+    ind = parent;
+  }
+  memcpy(lji_heap_entry(heap, ind), heap->scratch, stride);
+  slots[lji_heap_entry_slot(heap->scratch)].position = ind;
+}
+
+/// @private
+/// Moves the entry in scratch down from the hole at ind, then drops it in.
+void lji_heap_sift_down(lj_heap_t *heap, size_t ind) {
+  size_t stride = heap->entries.element_size;
+  size_t count = lj_vector_size(&heap->entries);
+  lji_heap_slot_t *slots = lji_heap_slots(heap);
+  for (;;) {
+    size_t first = ind * LJ_HEAP_ARITY_K + 1U;
+    if (first >= count) {
+      break;
+    }
+    size_t last = first + LJ_HEAP_ARITY_K < count ? first + LJ_HEAP_ARITY_K
+                                                  : count;
+    size_t best = first;
+    for (size_t child = first + 1U; child < last; child++) {
+      if (lji_heap_compare(heap, lji_heap_entry(heap, child),
+                           lji_heap_entry(heap, best)) < 0) {
+        best = child;
+      }
+    }
+    char *best_entry = lji_heap_entry(heap, best);
+    if (lji_heap_compare(heap, best_entry, heap->scratch) >= 0) {
+      break;
+    }
+    memcpy(lji_heap_entry(heap, ind), best_entry, stride);
+    slots[lji_heap_entry_slot(best_entry)].position = ind;
+    ind = best;
+  }
+  memcpy(lji_heap_entry(heap, ind), heap->scratch, stride);
+  slots[lji_heap_entry_slot(heap->scratch)].position = ind;
+}
+
+/// @brief Create a new, empty heap.
+/// @param element_size The result of sizeof(element).
+/// @param compare_fn Compares two elements like qsort(3) does: negative if the
+/// first should come out first, positive if the second should, zero if either
+/// will do.
+/// @param allocator The allocator to use.
+/// @return The new heap. If allocation failed, its scratch buffer is NULL and
+/// it must not be used other than to be deleted.
+lj_heap_t lj_new_heap(size_t element_size,
+                      int (*compare_fn)(const void *, const void *),
+                      lj_allocator_t *allocator) {
+  size_t stride = lji_heap_stride(element_size);
+  lj_heap_t heap = {
+      .entries = lj_new_vector(stride, allocator),
+      .slots = lj_new_vector(sizeof(lji_heap_slot_t), allocator),
+      .free_slots = lj_new_vector(sizeof(size_t), allocator),
+      .element_size = element_size,
+      .compare_fn = compare_fn,
+      .scratch = (char *)lj_allocate(allocator, stride),
+      .allocator = allocator,
+  };
+  if (heap.entries.buffer_start == NULL || heap.slots.buffer_start == NULL ||
+      heap.free_slots.buffer_start == NULL) {
+    lj_deallocate(allocator, heap.scratch);
+    heap.scratch = NULL;
+  }
+  return heap;
+}
+
+/// @brief Build a heap out of an array of elements in linear time. The
+/// elements get handles 0 to count - 1 in array order.
+/// @param elements Pointer to count contiguous elements. They are copied.
+/// @param count The number of elements.
+/// @param element_size The result of sizeof(element).
+/// @param compare_fn Compares two elements, as for lj_new_heap.
+/// @param allocator The allocator to use.
+/// @return The new heap. If allocation failed, its scratch buffer is NULL and
+/// it must not be used other than to be deleted.
+lj_heap_t lj_heap_from_array(const void *elements, size_t count,
+                             size_t element_size,
+                             int (*compare_fn)(const void *, const void *),
+                             lj_allocator_t *allocator) {
+  lj_heap_t heap = lj_new_heap(element_size, compare_fn, allocator);
+  if (heap.scratch == NULL) {
+    return heap;
+  }
+  if (!lj_vector_reserve(&heap.entries, count) ||
+      !lj_vector_reserve(&heap.slots, count)) {
+    lj_deallocate(allocator, heap.scratch);
+    heap.scratch = NULL;
+    return heap;
+  }
+  size_t stride = heap.entries.element_size;
+  for (size_t i = 0; i < count; i++) {
+    char *entry = heap.entries.content_start + i * stride;
+    memcpy(entry, &i, sizeof(size_t));
+    memcpy(entry + sizeof(size_t), (const char *)elements + i * element_size,
+           element_size);
+    lji_heap_slots(&heap)[i] = (lji_heap_slot_t){.position = i};
+  }
+  heap.entries.content_end = heap.entries.content_start + count * stride;
+  heap.slots.content_end =
+      heap.slots.content_start + count * sizeof(lji_heap_slot_t);
+  if (count > 1U) {
+    for (size_t i = (count - 2U) / LJ_HEAP_ARITY_K + 1U; i-- > 0U;) {
+      memcpy(heap.scratch, lji_heap_entry(&heap, i), stride);
+      lji_heap_sift_down(&heap, i);
+    }
+  }
+  return heap;
+}
+
+/// @brief Delete a heap and free its memory.
+/// @param heap The heap to delete.
+void lj_heap_delete(lj_heap_t *heap) {
+  lj_delete_vector(&heap->entries);
+  lj_delete_vector(&heap->slots);
+  lj_delete_vector(&heap->free_slots);
+  lj_deallocate(heap->allocator, heap->scratch);
+  heap->scratch = NULL;
+}
+
+/// @brief Gets the number of elements in a heap.
+/// @param heap The heap in question.
+/// @return The number of elements.
+size_t lj_heap_size(lj_heap_t *heap) { return lj_vector_size(&heap->entries); }
+
+/// @brief Add an element to a heap.
+/// @param heap The heap in question.
+/// @param val Pointer to the value to add.
+/// @return The new element's handle, or LJ_HEAP_INVALID_HANDLE_K if the
+/// allocator could not provide the space, in which case the heap is unchanged.
+lj_heap_handle_t lj_heap_push(lj_heap_t *heap, const void *val) {
+  size_t count = lj_vector_size(&heap->entries);
+  if (!lj_vector_reserve(&heap->entries, count + 1U)) {
+    return LJ_HEAP_INVALID_HANDLE_K;
+  }
+  size_t slot;
+  if (!lj_vector_pop_back(&heap->free_slots, &slot)) {
+    lji_heap_slot_t fresh = {.position = LJI_HEAP_NO_POSITION_K};
+    slot = lj_vector_size(&heap->slots);
+    if (!lj_vector_push_back(&heap->slots, &fresh)) {
+      return LJ_HEAP_INVALID_HANDLE_K;
+    }
+  }
+  memcpy(heap->scratch, &slot, sizeof(size_t));
+  memcpy(heap->scratch + sizeof(size_t), val, heap->element_size);
+  heap->entries.content_end += heap->entries.element_size;
+  lji_heap_sift_up(heap, count);
+  return ((lj_heap_handle_t)lji_heap_slots(heap)[slot].generation << 32) |
+         slot;
+}
+
+/// @brief Look at the smallest element without removing it.
+/// @param heap The heap in question.
+/// @param out Pointer to a value that will be replaced by the element. Cannot
+/// be NULL.
+/// @return A bool; if false, the heap was empty.
+bool lj_heap_peek(lj_heap_t *heap, void *out) {
+  if (lj_vector_size(&heap->entries) == 0U) {
+    return false;
+  }
+  memcpy(out, lji_heap_entry(heap, 0U) + sizeof(size_t), heap->element_size);
+  return true;
+}
+
+/// @private
+void lji_heap_remove_at(lj_heap_t *heap, size_t ind, void *out) {
+  char *entry = lji_heap_entry(heap, ind);
+  size_t slot = lji_heap_entry_slot(entry);
+  if (out != NULL) {
+    memcpy(out, entry + sizeof(size_t), heap->element_size);
+  }
+  lji_heap_slot_t *freed = &lji_heap_slots(heap)[slot];
+  freed->position = LJI_HEAP_NO_POSITION_K;
+  freed->generation++;
+  // if this cannot grow the slot is simply never reused
+  lj_vector_push_back(&heap->free_slots, &slot);
+  lj_vector_pop_back(&heap->entries, heap->scratch);
+  if (ind == lj_vector_size(&heap->entries)) {
+    return;
+  }
+  // the old last entry fills the hole and may need to go either way
+  if (ind > 0U &&
+      lji_heap_compare(heap, heap->scratch,
+                       lji_heap_entry(heap, (ind - 1U) / LJ_HEAP_ARITY_K)) <
+          0) {
+    lji_heap_sift_up(heap, ind);
+  } else {
+    lji_heap_sift_down(heap, ind);
+  }
+}
+
+/// @brief Remove the smallest element from a heap.
+/// @param heap The heap in question.
+/// @param out Pointer to a value that will be replaced by the element. If NULL
+/// is passed in, the element is just dropped.
+/// @return A bool; if false, the heap was empty and is unchanged.
+bool lj_heap_pop(lj_heap_t *heap, void *out) {
+  if (lj_vector_size(&heap->entries) == 0U) {
+    return false;
+  }
+  lji_heap_remove_at(heap, 0U, out);
+  return true;
+}
+
+/// @private
+size_t lji_heap_position_of(lj_heap_t *heap, lj_heap_handle_t handle) {
+  size_t slot = (size_t)(handle & 0xFFFFFFFFU);
+  if (slot >= lj_vector_size(&heap->slots)) {
+    return LJI_HEAP_NO_POSITION_K;
+  }
+  lji_heap_slot_t *found = &lji_heap_slots(heap)[slot];
+  if (found->generation != (uint32_t)(handle >> 32)) {
+    return LJI_HEAP_NO_POSITION_K;
+  }
+  return found->position;
+}
+
+/// @brief Replace an element with one that compares smaller or equal, moving
+/// it towards the front.
+/// @param heap The heap in question.
+/// @param handle The element's handle.
+/// @param val Pointer to the new value.
+/// @return A bool; if false, the handle's element has left the heap or the new
+/// value compares greater, and the heap is unchanged.
+bool lj_heap_decrease_key(lj_heap_t *heap, lj_heap_handle_t handle,
+                          const void *val) {
+  size_t ind = lji_heap_position_of(heap, handle);
+  if (ind == LJI_HEAP_NO_POSITION_K ||
+      heap->compare_fn(val, lji_heap_entry(heap, ind) + sizeof(size_t)) > 0) {
+    return false;
+  }
+  memcpy(heap->scratch, lji_heap_entry(heap, ind), sizeof(size_t));
+  memcpy(heap->scratch + sizeof(size_t), val, heap->element_size);
+  lji_heap_sift_up(heap, ind);
+  return true;
+}
+
+/// @brief Remove an element from anywhere in a heap.
+/// @param heap The heap in question.
+/// @param handle The element's handle.
+/// @param out Pointer to a value that will be replaced by the element. If NULL
+/// is passed in, the element is just dropped.
+/// @return A bool; if false, the handle's element has left the heap and the
+/// heap is unchanged.
+bool lj_heap_remove(lj_heap_t *heap, lj_heap_handle_t handle, void *out) {
+  size_t ind = lji_heap_position_of(heap, handle);
+  if (ind == LJI_HEAP_NO_POSITION_K) {
+    return false;
+  }
+  lji_heap_remove_at(heap, ind, out);
+  return true;
+}
+
+#endif
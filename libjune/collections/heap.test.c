@@ -0,0 +1,153 @@
+#include <libjune/collections/heap.h>
+#include <libjune/unit.h>
+#include <stdio.h>
+
+static int compare_int(const void *a, const void *b) {
+  int x = *(const int *)a;
+  int y = *(const int *)b;
+  return (x > y) - (x < y);
+}
+
+static char *test_push_pop_order(void) {
+  lj_heap_t heap =
+      lj_new_heap(sizeof(int), &compare_int, &lj_default_allocator);
+  for (int i = 0; i < 1000; i++) {
+    int val = (i * 7919) % 1000;
+    lj_heap_push(&heap, &val);
+  }
+  lj_assert(lj_heap_size(&heap) == 1000, "every push should be counted");
+  int top;
+  lj_assert(lj_heap_peek(&heap, &top) && top == 0,
+            "peek should see the smallest element");
+  for (int i = 0; i < 1000; i++) {
+    int val;
+    lj_assert(lj_heap_pop(&heap, &val) && val == i,
+              "elements should come out in order");
+  }
+  lj_assert(!lj_heap_pop(&heap, NULL), "popping an empty heap should fail");
+  lj_heap_delete(&heap);
+  return 0;
+}
+
+static char *test_heapify(void) {
+  int elements[500];
+  for (int i = 0; i < 500; i++) {
+    elements[i] = 499 - i;
+  }
+  lj_heap_t heap = lj_heap_from_array(elements, 500, sizeof(int), &compare_int,
+                                      &lj_default_allocator);
+  int val;
+  lj_assert(lj_heap_remove(&heap, 0, &val) && val == 499,
+            "handles should follow array order");
+  for (int i = 0; i < 499; i++) {
+    lj_assert(lj_heap_pop(&heap, &val) && val == i,
+              "a built heap should pop in order");
+  }
+  lj_heap_delete(&heap);
+  return 0;
+}
+
+static char *test_handles(void) {
+  lj_heap_t heap =
+      lj_new_heap(sizeof(int), &compare_int, &lj_default_allocator);
+  lj_heap_handle_t handles[100];
+  for (int i = 0; i < 100; i++) {
+    int val = 1000 + i;
+    handles[i] = lj_heap_push(&heap, &val);
+  }
+  int smaller = 5;
+  int larger = 5000;
+  lj_assert(lj_heap_decrease_key(&heap, handles[73], &smaller),
+            "decreasing a key should succeed");
+  lj_assert(!lj_heap_decrease_key(&heap, handles[10], &larger),
+            "increasing a key through decrease_key should fail");
+  int val;
+  lj_assert(lj_heap_remove(&heap, handles[50], &val) && val == 1050,
+            "removing by handle should return the element");
+  lj_assert(!lj_heap_remove(&heap, handles[50], NULL),
+            "a removed handle should no longer be valid");
+  lj_assert(lj_heap_pop(&heap, &val) && val == 5,
+            "a decreased key should come out first");
+  int last = -1;
+  while (lj_heap_pop(&heap, &val)) {
+    lj_assert(val > last && val != 1050 && val != 1073,
+              "the rest should come out in order");
+    last = val;
+  }
+  lj_heap_delete(&heap);
+  return 0;
+}
+
+static char *test_stale_handle(void) {
+  lj_heap_t heap =
+      lj_new_heap(sizeof(int), &compare_int, &lj_default_allocator);
+  int val = 10;
+  lj_heap_handle_t old = lj_heap_push(&heap, &val);
+  lj_assert(lj_heap_pop(&heap, NULL), "the element should pop");
+  val = 20;
+  lj_heap_handle_t fresh = lj_heap_push(&heap, &val);
+  lj_assert(fresh != old, "a reused slot should get a new handle");
+  int smaller = 1;
+  lj_assert(!lj_heap_decrease_key(&heap, old, &smaller),
+            "a stale handle should not change a newer element");
+  lj_assert(!lj_heap_remove(&heap, old, NULL),
+            "a stale handle should not remove a newer element");
+  lj_assert(lj_heap_size(&heap) == 1 && lj_heap_peek(&heap, &val) && val == 20,
+            "the newer element should be untouched");
+  lj_assert(lj_heap_remove(&heap, fresh, &val) && val == 20,
+            "the current handle should still work");
+  lj_heap_delete(&heap);
+  return 0;
+}
+
+static void *budget_allocate(void *state, size_t volume) {
+  size_t *budget = (size_t *)state;
+  if (*budget == 0U) {
+    return NULL;
+  }
+  (*budget)--;
+  return malloc(volume);
+}
+
+static void budget_deallocate(void *state, void *memory) { free(memory); }
+
+static char *test_allocation_failure(void) {
+  // enough for an empty heap, but not for the room to load 1000 elements
+  size_t budget = 4U;
+  lj_allocator_t allocator = {
+      .allocate_fn = &budget_allocate,
+      .deallocate_fn = &budget_deallocate,
+      .state = &budget,
+      .reallocate_fn = NULL,
+  };
+  static int elements[1000];
+  lj_heap_t heap = lj_heap_from_array(elements, 1000, sizeof(int),
+                                      &compare_int, &allocator);
+  lj_assert(heap.scratch == NULL,
+            "a heap that could not hold its elements should be marked failed");
+  lj_heap_delete(&heap);
+  budget = 4U;
+  heap = lj_new_heap(sizeof(int), &compare_int, &allocator);
+  lj_assert(heap.scratch != NULL, "an empty heap should fit the budget");
+  size_t pushed = 0;
+  for (int i = 0; i < 1000; i++) {
+    if (lj_heap_push(&heap, &i) == LJ_HEAP_INVALID_HANDLE_K) {
+      break;
+    }
+    pushed++;
+  }
+  lj_assert(pushed < 1000 && lj_heap_size(&heap) == pushed,
+            "a failed push should leave the heap unchanged");
+  lj_heap_delete(&heap);
+  return 0;
+}
+
+int main(const int argc, const char **argv) {
+  lj_run_test(test_push_pop_order);
+  lj_run_test(test_heapify);
+  lj_run_test(test_handles);
+  lj_run_test(test_stale_handle);
+  lj_run_test(test_allocation_failure);
+  lj_finish_tests();
+  return 0;
+}
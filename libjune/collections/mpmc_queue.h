@@ -0,0 +1,288 @@
+/// @file libjune/collections/mpmc_queue.h
+
+#ifndef LIBJUNE_COLLECTIONS_MPMC_QUEUE_H
+#define LIBJUNE_COLLECTIONS_MPMC_QUEUE_H
+
+#if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 201112L ||               \
+    defined(__STDC_NO_ATOMICS__)
+#error "libjune/collections/mpmc_queue.h requires C11 atomics"
+#endif
+
+#include <libjune/memory.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+/// @brief Bounded queue of fixed-size elements that any number of threads can
+/// enqueue into and dequeue from at once without locks. Each slot carries a
+/// sequence number saying whose turn it is to touch it. The object itself must
+/// not be moved or copied once threads are using it.
+typedef struct {
+  lj_allocator_t *allocator;
+  size_t element_size;
+  size_t slot_stride;
+  size_t mask;
+  char *slots;
+  char padding0[LJ_CACHE_LINE_SIZE_K];
+  atomic_size_t enqueue_position;
+  char padding1[LJ_CACHE_LINE_SIZE_K];
+  atomic_size_t dequeue_position;
+  char padding2[LJ_CACHE_LINE_SIZE_K];
+} lj_mpmc_queue_t;
+
+/// @private
+atomic_size_t *lji_mpmc_queue_sequence(lj_mpmc_queue_t *queue,
+                                       size_t position) {
+  return (atomic_size_t *)(queue->slots +
+                           (position & queue->mask) * queue->slot_stride);
+}
+
+/// @private
+char *lji_mpmc_queue_element(lj_mpmc_queue_t *queue, size_t position) {
+  return queue->slots + (position & queue->mask) * queue->slot_stride +
+         sizeof(atomic_size_t);
+}
+
+/// @brief Create a new queue.
+/// @param element_size The result of sizeof(element).
+/// @param capacity The maximum number of elements the queue can hold. Rounded
+/// up to a power of two.
+/// @param allocator The allocator the slot storage comes from.
+/// @return The new queue. If allocation failed, its slots are NULL and it must
+/// not be used.
+lj_mpmc_queue_t lj_new_mpmc_queue(size_t element_size, size_t capacity,
+                                  lj_allocator_t *allocator) {
+  size_t rounded = 2U;
+  while (rounded < capacity) {
+    rounded <<= 1;
+  }
+  size_t align = _Alignof(atomic_size_t);
+  size_t stride = sizeof(atomic_size_t) + element_size;
+  stride = (stride + align - 1U) / align * align;
+  char *slots = (char *)lj_allocate(allocator, rounded * stride);
+  lj_mpmc_queue_t queue = {
+      .allocator = allocator,
+      .element_size = element_size,
+      .slot_stride = stride,
+      .mask = rounded - 1U,
+      .slots = slots,
+  };
+  atomic_init(&queue.enqueue_position, 0U);
+  atomic_init(&queue.dequeue_position, 0U);
+  if (slots != NULL) {
+    for (size_t i = 0; i < rounded; i++) {
+      atomic_init(lji_mpmc_queue_sequence(&queue, i), i);
+    }
+  }
+  return queue;
+}
+
+/// @brief Delete a queue and free its memory. No other thread may be using it.
+/// @param queue The queue to delete.
+void lj_mpmc_queue_delete(lj_mpmc_queue_t *queue) {
+  lj_deallocate(queue->allocator, queue->slots);
+  queue->slots = NULL;
+}
+
+/// @brief Gets the number of elements a queue can hold.
+/// @param queue The queue in question.
+/// @return The capacity of the queue.
+size_t lj_mpmc_queue_capacity(lj_mpmc_queue_t *queue) {
+  return queue->mask + 1U;
+}
+
+/// @brief Add an element to a queue. Safe to call from any number of threads,
+/// but not alongside lj_mpmc_queue_enqueue_single on the same queue.
+/// @param queue The queue in question.
+/// @param val Pointer to the value to add.
+/// @return A bool; if false, the queue was full and is unchanged.
+bool lj_mpmc_queue_enqueue(lj_mpmc_queue_t *queue, const void *val) {
+  size_t position =
+      atomic_load_explicit(&queue->enqueue_position, memory_order_relaxed);
+  atomic_size_t *sequence;
+  for (;;) {
+    sequence = lji_mpmc_queue_sequence(queue, position);
+    size_t seen = atomic_load_explicit(sequence, memory_order_acquire);
+    ptrdiff_t diff = (ptrdiff_t)(seen - position);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(
+              &queue->enqueue_position, &position, position + 1U,
+              memory_order_relaxed, memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      position =
+          atomic_load_explicit(&queue->enqueue_position, memory_order_relaxed);
+    }
+  }
+  memcpy(lji_mpmc_queue_element(queue, position), val, queue->element_size);
+  atomic_store_explicit(sequence, position + 1U, memory_order_release);
+  return true;
+}
+
+/// @brief Remove the oldest element from a queue. Safe to call from any number
+/// of threads, but not alongside lj_mpmc_queue_dequeue_single on the same
+/// queue.
+/// @param queue The queue in question.
+/// @param out A pointer to a value to replace with the element. If NULL is
+/// passed in, the element is just dropped.
+/// @return A bool; if false, the queue was empty and is unchanged.
+bool lj_mpmc_queue_dequeue(lj_mpmc_queue_t *queue, void *out) {
+  size_t position =
+      atomic_load_explicit(&queue->dequeue_position, memory_order_relaxed);
+  atomic_size_t *sequence;
+  for (;;) {
+    sequence = lji_mpmc_queue_sequence(queue, position);
+    size_t seen = atomic_load_explicit(sequence, memory_order_acquire);
+    ptrdiff_t diff = (ptrdiff_t)(seen - (position + 1U));
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(
+              &queue->dequeue_position, &position, position + 1U,
+              memory_order_relaxed, memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false;
+    } else {
+      position =
+          atomic_load_explicit(&queue->dequeue_position, memory_order_relaxed);
+    }
+  }
+  if (out != NULL) {
+    memcpy(out, lji_mpmc_queue_element(queue, position), queue->element_size);
+  }
+  atomic_store_explicit(sequence, position + queue->mask + 1U,
+                        memory_order_release);
+  return true;
+}
+
+/// @brief Add an element to a queue that only one thread ever enqueues into.
+/// Skips the compare-and-swap; paired with lj_mpmc_queue_dequeue_single it
+/// gives an SPSC queue, and with lj_mpmc_queue_dequeue or
+/// lj_mpmc_queue_dequeue_n an SPMC queue. Mixing it with lj_mpmc_queue_enqueue
+/// or lj_mpmc_queue_enqueue_n on the same queue has undefined behavior, since
+/// they advance the same cursor.
+/// @param queue The queue in question.
+/// @param val Pointer to the value to add.
+/// @return A bool; if false, the queue was full and is unchanged.
+bool lj_mpmc_queue_enqueue_single(lj_mpmc_queue_t *queue, const void *val) {
+  size_t position =
+      atomic_load_explicit(&queue->enqueue_position, memory_order_relaxed);
+  atomic_size_t *sequence = lji_mpmc_queue_sequence(queue, position);
+  if (atomic_load_explicit(sequence, memory_order_acquire) != position) {
+    return false;
+  }
+  memcpy(lji_mpmc_queue_element(queue, position), val, queue->element_size);
+  atomic_store_explicit(sequence, position + 1U, memory_order_release);
+  atomic_store_explicit(&queue->enqueue_position, position + 1U,
+                        memory_order_relaxed);
+  return true;
+}
+
+/// @brief Remove the oldest element from a queue that only one thread ever
+/// dequeues from. Skips the compare-and-swap; paired with any enqueue function
+/// it gives an SPSC or MPSC queue. Mixing it with lj_mpmc_queue_dequeue or
+/// lj_mpmc_queue_dequeue_n on the same queue has undefined behavior, since
+/// they advance the same cursor.
+/// @param queue The queue in question.
+/// @param out A pointer to a value to replace with the element. If NULL is
+/// passed in, the element is just dropped.
+/// @return A bool; if false, the queue was empty and is unchanged.
+bool lj_mpmc_queue_dequeue_single(lj_mpmc_queue_t *queue, void *out) {
+  size_t position =
+      atomic_load_explicit(&queue->dequeue_position, memory_order_relaxed);
+  atomic_size_t *sequence = lji_mpmc_queue_sequence(queue, position);
+  if (atomic_load_explicit(sequence, memory_order_acquire) != position + 1U) {
+    return false;
+  }
+  if (out != NULL) {
+    memcpy(out, lji_mpmc_queue_element(queue, position), queue->element_size);
+  }
+  atomic_store_explicit(sequence, position + queue->mask + 1U,
+                        memory_order_release);
+  atomic_store_explicit(&queue->dequeue_position, position + 1U,
+                        memory_order_relaxed);
+  return true;
+}
+
+/// @private
+/// Claims up to count consecutive positions whose slots are at expected_offset
+/// past their position, returning the first claimed position through first.
+size_t lji_mpmc_queue_claim(lj_mpmc_queue_t *queue, atomic_size_t *cursor,
+                            size_t expected_offset, size_t count,
+                            size_t *first) {
+  size_t position = atomic_load_explicit(cursor, memory_order_relaxed);
+  for (;;) {
+    size_t claimed = 0U;
+    size_t seen = 0U;
+    while (claimed < count) {
+      seen = atomic_load_explicit(
+          lji_mpmc_queue_sequence(queue, position + claimed),
+          memory_order_acquire);
+      if (seen != position + claimed + expected_offset) {
+        break;
+      }
+      claimed++;
+    }
+    if (claimed == 0U) {
+      if ((ptrdiff_t)(seen - (position + expected_offset)) < 0) {
+        return 0U;
+      }
+      position = atomic_load_explicit(cursor, memory_order_relaxed);
+    } else if (atomic_compare_exchange_weak_explicit(
+                   cursor, &position, position + claimed,
+                   memory_order_relaxed, memory_order_relaxed)) {
+      *first = position;
+      return claimed;
+    }
+  }
+}
+
+/// @brief Add several elements to a queue at once, paying for a single
+/// compare-and-swap. Safe to call from any number of threads, but not
+/// alongside lj_mpmc_queue_enqueue_single on the same queue.
+/// @param queue The queue in question.
+/// @param vals Pointer to count contiguous values.
+/// @param count The number of values to add.
+/// @return The number of values actually added, taken from the front of vals.
+/// Less than count if the queue filled up.
+size_t lj_mpmc_queue_enqueue_n(lj_mpmc_queue_t *queue, const void *vals,
+                               size_t count) {
+  size_t first;
+  size_t claimed =
+      lji_mpmc_queue_claim(queue, &queue->enqueue_position, 0U, count, &first);
+  for (size_t i = 0; i < claimed; i++) {
+    memcpy(lji_mpmc_queue_element(queue, first + i),
+           (const char *)vals + i * queue->element_size, queue->element_size);
+    atomic_store_explicit(lji_mpmc_queue_sequence(queue, first + i),
+                          first + i + 1U, memory_order_release);
+  }
+  return claimed;
+}
+
+/// @brief Remove several elements from a queue at once, paying for a single
+/// compare-and-swap. Safe to call from any number of threads, but not
+/// alongside lj_mpmc_queue_dequeue_single on the same queue.
+/// @param queue The queue in question.
+/// @param out Pointer to room for count contiguous values, oldest first.
+/// @param count The maximum number of values to remove.
+/// @return The number of values actually removed. Less than count if the queue
+/// ran dry.
+size_t lj_mpmc_queue_dequeue_n(lj_mpmc_queue_t *queue, void *out,
+                               size_t count) {
+  size_t first;
+  size_t claimed =
+      lji_mpmc_queue_claim(queue, &queue->dequeue_position, 1U, count, &first);
+  for (size_t i = 0; i < claimed; i++) {
+    memcpy((char *)out + i * queue->element_size,
+           lji_mpmc_queue_element(queue, first + i), queue->element_size);
+    atomic_store_explicit(lji_mpmc_queue_sequence(queue, first + i),
+                          first + i + queue->mask + 1U, memory_order_release);
+  }
+  return claimed;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include <libjune/collections/mpmc_queue.h>
+#include <libjune/unit.h>
+#include <stdio.h>
+#include <threads.h>
+
+static char *test_fifo_order(void) {
+  lj_mpmc_queue_t queue = lj_new_mpmc_queue(sizeof(int), 5, &lj_default_allocator);
+  lj_assert(lj_mpmc_queue_capacity(&queue) == 8,
+            "capacity should round up to a power of two");
+  for (int i = 0; i < 8; i++) {
+    lj_assert(lj_mpmc_queue_enqueue(&queue, &i), "queue should not be full");
+  }
+  int extra = 8;
+  lj_assert(!lj_mpmc_queue_enqueue(&queue, &extra),
+            "enqueueing into a full queue should return false");
+  for (int i = 0; i < 8; i++) {
+    int j;
+    lj_assert(lj_mpmc_queue_dequeue(&queue, &j), "queue should not be empty");
+    lj_assert(i == j, "elements should come out in the order they went in");
+  }
+  lj_assert(!lj_mpmc_queue_dequeue(&queue, NULL),
+            "dequeueing from an empty queue should return false");
+  lj_mpmc_queue_delete(&queue);
+  return 0;
+}
+
+static char *test_batches(void) {
+  lj_mpmc_queue_t queue = lj_new_mpmc_queue(sizeof(int), 8, &lj_default_allocator);
+  int in[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+  int out[12] = {0};
+  lj_assert(lj_mpmc_queue_enqueue_n(&queue, in, 12) == 8,
+            "a batch should stop once the queue is full");
+  lj_assert(lj_mpmc_queue_dequeue_n(&queue, out, 3) == 3,
+            "a batch should take what was asked for when it is available");
+  lj_assert(lj_mpmc_queue_enqueue_single(&queue, &in[8]),
+            "single-producer enqueue should reuse freed slots");
+  lj_assert(lj_mpmc_queue_dequeue_n(&queue, out + 3, 12) == 6,
+            "a batch should stop once the queue is empty");
+  for (int i = 0; i < 9; i++) {
+    lj_assert(out[i] == i, "batches should preserve order");
+  }
+  lj_mpmc_queue_delete(&queue);
+  return 0;
+}
+
+#define PER_PRODUCER 100000
+#define PRODUCERS 4
+
+static lj_mpmc_queue_t shared_queue;
+static atomic_llong consumed_sum;
+static atomic_int consumed_count;
+
+static int produce(void *arg) {
+  int base = *(int *)arg * PER_PRODUCER;
+  for (int i = 0; i < PER_PRODUCER; i++) {
+    int val = base + i;
+    while (!lj_mpmc_queue_enqueue(&shared_queue, &val)) {
+      thrd_yield();
+    }
+  }
+  return 0;
+}
+
+static int consume(void *arg) {
+  int val;
+  while (atomic_load(&consumed_count) < PER_PRODUCER * PRODUCERS) {
+    if (lj_mpmc_queue_dequeue(&shared_queue, &val)) {
+      atomic_fetch_add(&consumed_sum, val);
+      atomic_fetch_add(&consumed_count, 1);
+    } else {
+      thrd_yield();
+    }
+  }
+  return 0;
+}
+
+static char *test_threads(void) {
+  shared_queue = lj_new_mpmc_queue(sizeof(int), 1024, &lj_default_allocator);
+  thrd_t producers[PRODUCERS];
+  thrd_t consumers[PRODUCERS];
+  int ids[PRODUCERS];
+  for (int i = 0; i < PRODUCERS; i++) {
+    ids[i] = i;
+    thrd_create(&producers[i], produce, &ids[i]);
+    thrd_create(&consumers[i], consume, NULL);
+  }
+  for (int i = 0; i < PRODUCERS; i++) {
+    thrd_join(producers[i], NULL);
+    thrd_join(consumers[i], NULL);
+  }
+  long long total = PER_PRODUCER * PRODUCERS;
+  lj_assert(atomic_load(&consumed_sum) == total * (total - 1) / 2,
+            "every element should be dequeued exactly once");
+  lj_mpmc_queue_delete(&shared_queue);
+  return 0;
+}
+
+int main(const int argc, const char **argv) {
+  lj_run_test(test_fifo_order);
+  lj_run_test(test_batches);
+  lj_run_test(test_threads);
+  lj_finish_tests();
+  return 0;
+}
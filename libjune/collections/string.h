@@ -15,6 +15,13 @@
 /// @brief A basic ASCII string.
 typedef lj_vector_t lj_string_t;
 
+/// @brief A read-only window onto characters owned by something else. Not
+/// null-terminated.
+typedef struct {
+  const char *start;
+  size_t length;
+} lj_string_view_t;
+
 /// @brief Create a new, empty string.
 /// @param allocator The allocator to use.
 /// @return The resulting string.
@@ -58,6 +65,15 @@ lj_string_t lj_string_from_cstr(const char *str, lj_allocator_t *allocator) {
   return result;
 }
 
+/// @brief Create a string from a string view, copying its characters.
+/// @param view The view in question.
+/// @param allocator The allocator to use.
+/// @return The new string.
+lj_string_t lj_string_from_view(lj_string_view_t view,
+                                lj_allocator_t *allocator) {
+  return lj_string_from_array(view.start, view.length, allocator);
+}
+
 /// @brief Convert an lj_string_t to a C-style string.
 /// @param str The string to convert.
 /// @return A constant null terminated string with the same contents. This
@@ -75,8 +91,9 @@ size_t lj_string_length(lj_string_t *str) { return lj_vector_size(str) - 1; }
 /// @param str The string in question.
 /// @param vol The minimum number of characters the buffer should be able to
 /// hold without growing.
-void lj_string_reserve(lj_string_t *str, size_t vol) {
-  lj_vector_reserve(str, vol + 1);
+/// @return A bool; if false, the allocator could not provide the space.
+bool lj_string_reserve(lj_string_t *str, size_t vol) {
+  return lj_vector_reserve(str, vol + 1);
 }
 
 /// @brief Remove all extra space in the string buffer.
@@ -112,8 +129,10 @@ bool lj_string_get(lj_string_t *str, size_t ind, char *out) {
 /// @param str The string in question.
 /// @param val The character to add.
 void lj_string_push_back(lj_string_t *str, char val) {
+  char NULL_TERMINATOR = '\0';
   lj_vector_pop_back(str, NULL);
   lj_vector_push_back(str, &val);
+  lj_vector_push_back(str, &NULL_TERMINATOR);
 }
 
 /// @brief Remove the last character from a string.
@@ -122,13 +141,11 @@ void lj_string_push_back(lj_string_t *str, char val) {
 /// the string. If NULL is passed in, the last character is just dropped.
 /// @return A bool indicating if a character was successfully removed.
 bool lj_string_pop_back(lj_string_t *str, char *out) {
+  char NULL_TERMINATOR = '\0';
   lj_vector_pop_back(str, NULL);
-  if (!lj_vector_pop_back(str, out)) {
-    char NULL_TERMINATOR = '\0';
-    lj_vector_push_back(str, &NULL_TERMINATOR);
-    return false;
-  }
-  return true;
+  bool popped = lj_vector_pop_back(str, out);
+  lj_vector_push_back(str, &NULL_TERMINATOR);
+  return popped;
 }
 
 /// @brief Determines if two strings are equal.
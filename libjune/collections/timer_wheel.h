@@ -0,0 +1,290 @@
+/// @file libjune/collections/timer_wheel.h
+
+#ifndef LIBJUNE_COLLECTIONS_TIMER_WHEEL_H
+#define LIBJUNE_COLLECTIONS_TIMER_WHEEL_H
+
+#include <libjune/collections/vector.h>
+#include <libjune/memory.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/// @brief Number of bits of the deadline each level of a timer wheel covers.
+#define LJ_TIMER_WHEEL_SLOT_BITS_K 6U
+
+/// @brief Number of levels in a timer wheel. Deadlines up to 2^36 ticks away
+/// are placed exactly; later ones wait in the top level and are placed again
+/// each time it comes around.
+#define LJ_TIMER_WHEEL_LEVELS_K 6U
+
+/// @private
+#define LJI_TIMER_WHEEL_SLOTS_K (1U << LJ_TIMER_WHEEL_SLOT_BITS_K)
+
+/// @private
+#define LJI_TIMER_WHEEL_FIRING_K                                               \
+  (LJ_TIMER_WHEEL_LEVELS_K * LJI_TIMER_WHEEL_SLOTS_K)
+
+/// @private
+#define LJI_TIMER_NONE_K SIZE_MAX
+
+/// @private
+typedef struct {
+  uint64_t deadline;
+  void *data;
+  size_t prev;
+  size_t next;
+  size_t slot;
+  uint32_t generation;
+} lji_timer_t;
+
+/// @brief Handle for a pending timer. Handles of fired or cancelled timers are
+/// never mistaken for newer ones.
+typedef uint64_t lj_timer_handle_t;
+
+/// @brief Handle value that never refers to a timer.
+#define LJ_TIMER_WHEEL_INVALID_HANDLE_K UINT64_MAX
+
+/// @brief Hierarchical timing wheel: a large number of timeouts, each inserted
+/// and cancelled in constant time, expired a whole slot at a time as the clock
+/// is advanced. Time is measured in whole ticks of whatever length the caller
+/// chooses.
+typedef struct {
+  lj_vector_t timers;
+  size_t free_head;
+  size_t count;
+  uint64_t now;
+  uint64_t occupied[LJ_TIMER_WHEEL_LEVELS_K];
+  size_t heads[LJI_TIMER_WHEEL_FIRING_K + 1U];
+} lj_timer_wheel_t;
+
+/// @brief Create a new, empty timer wheel.
+/// @param now The current tick.
+/// @param allocator The allocator to use for the timers.
+/// @return The new timer wheel.
+lj_timer_wheel_t lj_new_timer_wheel(uint64_t now, lj_allocator_t *allocator) {
+  lj_timer_wheel_t wheel = {
+      .timers = lj_new_vector(sizeof(lji_timer_t), allocator),
+      .free_head = LJI_TIMER_NONE_K,
+      .count = 0U,
+      .now = now,
+  };
+  for (size_t i = 0; i <= LJI_TIMER_WHEEL_FIRING_K; i++) {
+    wheel.heads[i] = LJI_TIMER_NONE_K;
+  }
+  return wheel;
+}
+
+/// @brief Delete a timer wheel and free its memory. Pending timers are
+/// dropped without firing.
+/// @param wheel The timer wheel to delete.
+void lj_timer_wheel_delete(lj_timer_wheel_t *wheel) {
+  lj_delete_vector(&wheel->timers);
+  wheel->count = 0U;
+}
+
+/// @brief Gets the number of pending timers.
+/// @param wheel The timer wheel in question.
+/// @return The number of timers that have neither fired nor been cancelled.
+size_t lj_timer_wheel_size(lj_timer_wheel_t *wheel) { return wheel->count; }
+
+/// @brief Gets the tick a timer wheel has been advanced to.
+/// @param wheel The timer wheel in question.
+/// @return The current tick.
+uint64_t lj_timer_wheel_now(lj_timer_wheel_t *wheel) { return wheel->now; }
+
+/// @private
+lji_timer_t *lji_timer_wheel_timers(lj_timer_wheel_t *wheel) {
+  return (lji_timer_t *)wheel->timers.content_start;
+}
+
+/// @private
+void lji_timer_wheel_link(lj_timer_wheel_t *wheel, size_t ind, size_t slot) {
+  lji_timer_t *timers = lji_timer_wheel_timers(wheel);
+  timers[ind].slot = slot;
+  timers[ind].prev = LJI_TIMER_NONE_K;
+  timers[ind].next = wheel->heads[slot];
+  if (wheel->heads[slot] != LJI_TIMER_NONE_K) {
+    timers[wheel->heads[slot]].prev = ind;
+  }
+  wheel->heads[slot] = ind;
+  if (slot < LJI_TIMER_WHEEL_FIRING_K) {
+    wheel->occupied[slot / LJI_TIMER_WHEEL_SLOTS_K] |=
+        (uint64_t)1U << (slot % LJI_TIMER_WHEEL_SLOTS_K);
+  }
+}
+
+/// @private
+void lji_timer_wheel_unlink(lj_timer_wheel_t *wheel, size_t ind) {
+  lji_timer_t *timers = lji_timer_wheel_timers(wheel);
+  lji_timer_t *timer = &timers[ind];
+  if (timer->prev != LJI_TIMER_NONE_K) {
+    timers[timer->prev].next = timer->next;
+  } else {
+    wheel->heads[timer->slot] = timer->next;
+    if (timer->next == LJI_TIMER_NONE_K &&
+        timer->slot < LJI_TIMER_WHEEL_FIRING_K) {
+      wheel->occupied[timer->slot / LJI_TIMER_WHEEL_SLOTS_K] &=
+          ~((uint64_t)1U << (timer->slot % LJI_TIMER_WHEEL_SLOTS_K));
+    }
+  }
+  if (timer->next != LJI_TIMER_NONE_K) {
+    timers[timer->next].prev = timer->prev;
+  }
+}
+
+/// @private
+/// Files a timer under the lowest level whose span around `from` contains its
+/// deadline. Deadlines before `from` are treated as due at `from`.
+void lji_timer_wheel_place(lj_timer_wheel_t *wheel, size_t ind,
+                           uint64_t from) {
+  uint64_t deadline = lji_timer_wheel_timers(wheel)[ind].deadline;
+  if (deadline < from) {
+    deadline = from;
+  }
+  size_t level = 0U;
+  while (level + 1U < LJ_TIMER_WHEEL_LEVELS_K &&
+         (deadline >> ((level + 1U) * LJ_TIMER_WHEEL_SLOT_BITS_K)) !=
+             (from >> ((level + 1U) * LJ_TIMER_WHEEL_SLOT_BITS_K))) {
+    level++;
+  }
+  size_t slot = (size_t)(deadline >> (level * LJ_TIMER_WHEEL_SLOT_BITS_K)) &
+                (LJI_TIMER_WHEEL_SLOTS_K - 1U);
+  lji_timer_wheel_link(wheel, ind, level * LJI_TIMER_WHEEL_SLOTS_K + slot);
+}
+
+/// @brief Schedule a timer.
+/// @param wheel The timer wheel in question.
+/// @param deadline The tick at which the timer fires. Deadlines that are not
+/// after the current tick fire on the next advance.
+/// @param data Passed to the expiry function when the timer fires.
+/// @return A handle that can cancel the timer, or
+/// LJ_TIMER_WHEEL_INVALID_HANDLE_K if the allocator could not provide the
+/// space, in which case the wheel is unchanged.
+lj_timer_handle_t lj_timer_wheel_insert(lj_timer_wheel_t *wheel,
+                                        uint64_t deadline, void *data) {
+  size_t ind = wheel->free_head;
+  if (ind != LJI_TIMER_NONE_K) {
+    wheel->free_head = lji_timer_wheel_timers(wheel)[ind].next;
+  } else {
+    lji_timer_t fresh = {.generation = 0U};
+    ind = lj_vector_size(&wheel->timers);
+    if (!lj_vector_push_back(&wheel->timers, &fresh)) {
+      return LJ_TIMER_WHEEL_INVALID_HANDLE_K;
+    }
+  }
+  lji_timer_t *timer = &lji_timer_wheel_timers(wheel)[ind];
+  timer->deadline = deadline;
+  timer->data = data;
+  lji_timer_wheel_place(wheel, ind, wheel->now + 1U);
+  wheel->count++;
+  return ((lj_timer_handle_t)timer->generation << 32) | ind;
+}
+
+/// @private
+void lji_timer_wheel_release(lj_timer_wheel_t *wheel, size_t ind) {
+  lji_timer_t *timer = &lji_timer_wheel_timers(wheel)[ind];
+  timer->slot = LJI_TIMER_NONE_K;
+  timer->generation++;
+  timer->next = wheel->free_head;
+  wheel->free_head = ind;
+  wheel->count--;
+}
+
+/// @brief Cancel a pending timer.
+/// @param wheel The timer wheel in question.
+/// @param handle The handle lj_timer_wheel_insert returned.
+/// @return A bool; if false, the timer had already fired or been cancelled.
+bool lj_timer_wheel_cancel(lj_timer_wheel_t *wheel, lj_timer_handle_t handle) {
+  size_t ind = (size_t)(handle & 0xFFFFFFFFU);
+  if (ind >= lj_vector_size(&wheel->timers)) {
+    return false;
+  }
+  lji_timer_t *timer = &lji_timer_wheel_timers(wheel)[ind];
+  if (timer->slot == LJI_TIMER_NONE_K ||
+      timer->generation != (uint32_t)(handle >> 32)) {
+    return false;
+  }
+  lji_timer_wheel_unlink(wheel, ind);
+  lji_timer_wheel_release(wheel, ind);
+  return true;
+}
+
+/// @private
+/// Takes a whole slot off the wheel and re-files each of its timers relative
+/// to the current tick.
+void lji_timer_wheel_cascade(lj_timer_wheel_t *wheel, size_t slot) {
+  size_t ind = wheel->heads[slot];
+  wheel->heads[slot] = LJI_TIMER_NONE_K;
+  wheel->occupied[slot / LJI_TIMER_WHEEL_SLOTS_K] &=
+      ~((uint64_t)1U << (slot % LJI_TIMER_WHEEL_SLOTS_K));
+  while (ind != LJI_TIMER_NONE_K) {
+    size_t next = lji_timer_wheel_timers(wheel)[ind].next;
+    lji_timer_wheel_place(wheel, ind, wheel->now);
+    ind = next;
+  }
+}
+
+/// @brief Move the clock forward, firing every timer whose deadline is passed.
+/// The expiry function may insert and cancel timers, including ones due in
+/// the same advance.
+/// @param wheel The timer wheel in question.
+/// @param now The new current tick. Earlier ticks are ignored.
+/// @param expire_fn Called once for each timer that fires, with the timer's
+/// data and ctx.
+/// @param ctx Passed to expire_fn unchanged.
+/// @return The number of timers that fired.
+size_t lj_timer_wheel_advance(lj_timer_wheel_t *wheel, uint64_t now,
+                              void (*expire_fn)(void *, void *), void *ctx) {
+  size_t fired = 0U;
+  while (wheel->now < now) {
+    if (wheel->count == 0U) {
+      wheel->now = now;
+      break;
+    }
+    uint64_t tick = wheel->now + 1U;
+    if (wheel->occupied[0] == 0U &&
+        (tick & (LJI_TIMER_WHEEL_SLOTS_K - 1U)) != 0U) {
+      // nothing in the bottom level; skip straight to its next turn
+      uint64_t turn = (tick | (LJI_TIMER_WHEEL_SLOTS_K - 1U)) + 1U;
+      tick = turn <= now ? turn : now;
+    }
+    wheel->now = tick;
+    // higher levels first, so timers they hand down to a level that is also
+    // turning over here are handed down again
+    for (size_t level = LJ_TIMER_WHEEL_LEVELS_K - 1U; level > 0U; level--) {
+      uint64_t span = (uint64_t)1U << (level * LJ_TIMER_WHEEL_SLOT_BITS_K);
+      if ((tick & (span - 1U)) != 0U) {
+        continue;
+      }
+      size_t slot = (size_t)(tick >> (level * LJ_TIMER_WHEEL_SLOT_BITS_K)) &
+                    (LJI_TIMER_WHEEL_SLOTS_K - 1U);
+      if (wheel->heads[level * LJI_TIMER_WHEEL_SLOTS_K + slot] !=
+          LJI_TIMER_NONE_K) {
+        lji_timer_wheel_cascade(wheel, level * LJI_TIMER_WHEEL_SLOTS_K + slot);
+      }
+    }
+    size_t slot = (size_t)tick & (LJI_TIMER_WHEEL_SLOTS_K - 1U);
+    if (wheel->heads[slot] == LJI_TIMER_NONE_K) {
+      continue;
+    }
+    // move the due slot aside so the expiry function can cancel its
+    // neighbours or schedule new timers safely
+    size_t ind = wheel->heads[slot];
+    wheel->heads[slot] = LJI_TIMER_NONE_K;
+    wheel->occupied[0] &= ~((uint64_t)1U << slot);
+    wheel->heads[LJI_TIMER_WHEEL_FIRING_K] = ind;
+    for (; ind != LJI_TIMER_NONE_K;
+         ind = lji_timer_wheel_timers(wheel)[ind].next) {
+      lji_timer_wheel_timers(wheel)[ind].slot = LJI_TIMER_WHEEL_FIRING_K;
+    }
+    while ((ind = wheel->heads[LJI_TIMER_WHEEL_FIRING_K]) != LJI_TIMER_NONE_K) {
+      void *data = lji_timer_wheel_timers(wheel)[ind].data;
+      lji_timer_wheel_unlink(wheel, ind);
+      lji_timer_wheel_release(wheel, ind);
+      expire_fn(data, ctx);
+      fired++;
+    }
+  }
+  return fired;
+}
+
+#endif
@@ -0,0 +1,135 @@
+#include <libjune/collections/timer_wheel.h>
+#include <libjune/unit.h>
+#include <stdio.h>
+
+typedef struct {
+  lj_timer_wheel_t *wheel;
+  uint64_t fired_at[2000];
+} record_t;
+
+static void record_expiry(void *data, void *ctx) {
+  record_t *record = (record_t *)ctx;
+  record->fired_at[(size_t)data] = lj_timer_wheel_now(record->wheel);
+}
+
+static char *test_fires_on_time(void) {
+  lj_timer_wheel_t wheel = lj_new_timer_wheel(1000, &lj_default_allocator);
+  static record_t record;
+  record.wheel = &wheel;
+  uint64_t deadlines[2000];
+  uint64_t seed = 12345;
+  for (size_t i = 0; i < 2000; i++) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    // mix of near, middle and far deadlines so every level gets used
+    uint64_t reach = (uint64_t)1U << (6U * (i % 5U) + 3U);
+    deadlines[i] = 1000 + (seed >> 33) % reach;
+    record.fired_at[i] = 0;
+    lj_timer_wheel_insert(&wheel, deadlines[i], (void *)i);
+  }
+  lj_assert(lj_timer_wheel_size(&wheel) == 2000, "every insert should count");
+  uint64_t now = 1000;
+  while (lj_timer_wheel_size(&wheel) > 0) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    now += 1 + (seed >> 33) % 5000;
+    uint64_t before = lj_timer_wheel_now(&wheel);
+    lj_timer_wheel_advance(&wheel, now, &record_expiry, &record);
+    for (size_t i = 0; i < 2000; i++) {
+      bool due = deadlines[i] <= now && deadlines[i] > before;
+      lj_assert(!due || record.fired_at[i] != 0,
+                "a due timer should fire in the advance that passes it");
+      lj_assert(record.fired_at[i] == 0 || record.fired_at[i] >= deadlines[i],
+                "no timer should fire early");
+    }
+  }
+  lj_timer_wheel_delete(&wheel);
+  return 0;
+}
+
+static lj_timer_handle_t pair[2];
+
+static void cancel_pair(void *data, void *ctx) {
+  lj_timer_wheel_t *wheel = (lj_timer_wheel_t *)ctx;
+  lj_timer_wheel_cancel(wheel, pair[0]);
+  lj_timer_wheel_cancel(wheel, pair[1]);
+  lj_timer_wheel_insert(wheel, 0, NULL);
+}
+
+static void count_expiry(void *data, void *ctx) { (*(int *)data)++; }
+
+static char *test_cancel(void) {
+  lj_timer_wheel_t wheel = lj_new_timer_wheel(0, &lj_default_allocator);
+  int count = 0;
+  lj_timer_handle_t a = lj_timer_wheel_insert(&wheel, 10, &count);
+  lj_timer_wheel_insert(&wheel, 20, &count);
+  lj_assert(lj_timer_wheel_cancel(&wheel, a), "a pending timer should cancel");
+  lj_assert(!lj_timer_wheel_cancel(&wheel, a),
+            "a timer should only cancel once");
+  lj_timer_handle_t b = lj_timer_wheel_insert(&wheel, 10, &count);
+  lj_assert(!lj_timer_wheel_cancel(&wheel, a),
+            "an old handle should not cancel a reused timer");
+  lj_assert(lj_timer_wheel_advance(&wheel, 100, &count_expiry, NULL) == 2 &&
+                count == 2,
+            "the remaining timers should fire");
+  lj_assert(!lj_timer_wheel_cancel(&wheel, b),
+            "a fired timer should not cancel");
+  lj_timer_wheel_delete(&wheel);
+  return 0;
+}
+
+static char *test_cancel_during_expiry(void) {
+  lj_timer_wheel_t wheel = lj_new_timer_wheel(0, &lj_default_allocator);
+  pair[0] = lj_timer_wheel_insert(&wheel, 5, NULL);
+  pair[1] = lj_timer_wheel_insert(&wheel, 5, NULL);
+  lj_assert(lj_timer_wheel_advance(&wheel, 5, &cancel_pair, &wheel) == 1,
+            "a timer cancelled by an earlier expiry should not fire");
+  lj_assert(lj_timer_wheel_size(&wheel) == 1,
+            "a timer scheduled from an expiry should wait for the next tick");
+  lj_timer_wheel_delete(&wheel);
+  return 0;
+}
+
+static void *budget_allocate(void *state, size_t volume) {
+  size_t *budget = (size_t *)state;
+  if (*budget == 0U) {
+    return NULL;
+  }
+  (*budget)--;
+  return malloc(volume);
+}
+
+static void budget_deallocate(void *state, void *memory) { free(memory); }
+
+static char *test_allocation_failure(void) {
+  size_t budget = SIZE_MAX;
+  lj_allocator_t allocator = {
+      .allocate_fn = &budget_allocate,
+      .deallocate_fn = &budget_deallocate,
+      .state = &budget,
+      .reallocate_fn = NULL,
+  };
+  lj_timer_wheel_t wheel = lj_new_timer_wheel(0, &allocator);
+  budget = 0U;
+  int count = 0;
+  size_t inserted = 0;
+  while (lj_timer_wheel_insert(&wheel, 10, &count) !=
+         LJ_TIMER_WHEEL_INVALID_HANDLE_K) {
+    inserted++;
+  }
+  lj_assert(lj_timer_wheel_size(&wheel) == inserted,
+            "a failed insert should not be counted");
+  lj_assert(lj_timer_wheel_advance(&wheel, 100, &count_expiry, NULL) ==
+                    inserted &&
+                count == (int)inserted,
+            "only the timers that were inserted should fire");
+  lj_timer_wheel_delete(&wheel);
+  return 0;
+}
+
+int main(const int argc, const char **argv) {
+  lj_run_test(test_fires_on_time);
+  lj_run_test(test_cancel);
+  lj_run_test(test_cancel_during_expiry);
+  lj_run_test(test_allocation_failure);
+  lj_finish_tests();
+  return 0;
+}
@@ -24,7 +24,8 @@ const size_t LJI_BUFFER_INITIAL_SIZE = 8U;
 /// @param element_size The result of sizeof(element).
 /// @param allocator An lj_allocator_t corresponding to the allocator the vector
 /// should use.
-/// @return The finished vector object.
+/// @return The finished vector object. If the first buffer could not be
+/// allocated it has no capacity, so growing it is tried again later.
 lj_vector_t lj_new_vector(size_t element_size, lj_allocator_t *allocator) {
   char *buffer =
       (char *)lj_allocate(allocator, LJI_BUFFER_INITIAL_SIZE * element_size);
@@ -34,7 +35,9 @@ lj_vector_t lj_new_vector(size_t element_size, lj_allocator_t *allocator) {
       .content_start = buffer,
       .content_end = buffer,
       .buffer_start = buffer,
-      .buffer_end = buffer + LJI_BUFFER_INITIAL_SIZE * element_size,
+      .buffer_end = buffer == NULL
+                        ? NULL
+                        : buffer + LJI_BUFFER_INITIAL_SIZE * element_size,
   };
 }
 
@@ -62,41 +65,60 @@ size_t lj_vector_capacity(lj_vector_t *vec) {
 }
 
 /// @private
-void lji_vector_grow(lj_vector_t *vec) {
-  memmove(vec->buffer_start, vec->content_start,
-          (vec->content_end - vec->content_start));
+/// Returns false if the allocator could not provide a bigger buffer, in which
+/// case the vector is unchanged.
+bool lji_vector_grow(lj_vector_t *vec) {
   size_t new_capacity = lj_vector_capacity(vec);
-  new_capacity += new_capacity / 2;
-  new_capacity += vec->element_size - (new_capacity % vec->element_size);
-  size_t content_length = lj_vector_size(vec);
-  void *buffer = lj_allocate(vec->allocator, new_capacity);
-  memcpy(buffer, vec->content_start, content_length);
-  vec->buffer_start = vec->content_start = (char *)buffer;
-  vec->buffer_end = vec->buffer_start + new_capacity;
+  new_capacity += new_capacity / 2 + 1;
+  new_capacity *= vec->element_size;
+  size_t start_offset = vec->content_start - vec->buffer_start;
+  size_t content_length = vec->content_end - vec->content_start;
+  char *buffer = (char *)lj_reallocate(vec->allocator, vec->buffer_start,
+                                       vec->buffer_end - vec->buffer_start,
+                                       new_capacity);
+  if (buffer == NULL) {
+    return false;
+  }
+  vec->buffer_start = buffer;
+  vec->content_start = buffer + start_offset;
   vec->content_end = vec->content_start + content_length;
+  vec->buffer_end = buffer + new_capacity;
+  return true;
 }
 
 /// @brief Grow the capacity of the vector to at least a certain size.
 /// @param vec The vector in question.
 /// @param space The space to grow to.
-void lj_vector_reserve(lj_vector_t *vec, size_t space) {
+/// @return A bool; if false, the allocator could not provide the space and the
+/// capacity may have grown only part of the way.
+bool lj_vector_reserve(lj_vector_t *vec, size_t space) {
   while (lj_vector_capacity(vec) < space) {
-    lji_vector_grow(vec);
+    if (!lji_vector_grow(vec)) {
+      return false;
+    }
   }
+  return true;
 }
 
 /// @brief Remove all the empty space in the vector buffer, leaving all
 /// remaining space full.
 /// @param vec The vector in question.
 void lj_vector_shrink_to_fit(lj_vector_t *vec) {
-  char *new_buffer = (char *)lj_allocate(vec->allocator,
-                                         vec->content_end - vec->content_start);
-  memcpy(new_buffer, vec->content_start, vec->content_end - vec->content_start);
-  free(vec->buffer_start);
-  vec->buffer_start = new_buffer;
-  vec->buffer_end = new_buffer + (vec->content_end - vec->content_start);
-  vec->content_end = vec->buffer_end;
-  vec->content_start = vec->buffer_start;
+  size_t content_length = vec->content_end - vec->content_start;
+  // never ask for zero bytes; realloc(3) is allowed to free the buffer for that
+  size_t volume = content_length > 0U ? content_length : vec->element_size;
+  memmove(vec->buffer_start, vec->content_start, content_length);
+  char *new_buffer = (char *)lj_reallocate(
+      vec->allocator, vec->buffer_start, vec->buffer_end - vec->buffer_start,
+      volume);
+  if (new_buffer == NULL) {
+    vec->content_start = vec->buffer_start;
+    vec->content_end = vec->buffer_start + content_length;
+    return;
+  }
+  vec->buffer_start = vec->content_start = new_buffer;
+  vec->content_end = new_buffer + content_length;
+  vec->buffer_end = new_buffer + volume;
 }
 
 /// @brief Clear out the contents of a vector.
@@ -152,12 +174,16 @@ bool lj_vector_set(lj_vector_t *vec, size_t ind, void *val) {
 /// @brief Add a new element to the end of a vector.
 /// @param vec The vector in question.
 /// @param val The value to add.
-void lj_vector_push_back(lj_vector_t *vec, void *val) {
+/// @return A bool; if false, the vector was full and could not grow, and it is
+/// unchanged.
+bool lj_vector_push_back(lj_vector_t *vec, void *val) {
+  if (vec->buffer_end - vec->content_end < vec->element_size &&
+      !lji_vector_grow(vec)) {
+    return false;
+  }
   memcpy(vec->content_end, val, vec->element_size);
   vec->content_end += vec->element_size;
-  if (vec->content_end - vec->buffer_end < vec->element_size) {
-    lji_vector_grow(vec);
-  }
+  return true;
 }
 
 /// @brief Take the last element off the end of a vector.
@@ -182,16 +208,24 @@ bool lj_vector_pop_back(lj_vector_t *vec, void *out) {
 /// @brief Add a new element to the beginning of the vector.
 /// @param vec The vector in question.
 /// @param val A pointer to the value of the new element.
-void lj_vector_push_front(lj_vector_t *vec, void *val) {
+/// @return A bool; if false, the vector was full and could not grow, and it is
+/// unchanged.
+bool lj_vector_push_front(lj_vector_t *vec, void *val) {
   if (vec->content_start == vec->buffer_start) {
-    if (vec->content_end == vec->buffer_end) {
-      lji_vector_grow(vec);
+    if (vec->buffer_end - vec->content_end < vec->element_size &&
+        !lji_vector_grow(vec)) {
+      return false;
     }
-    memmove(vec->content_start + (vec->buffer_end - vec->content_end),
-            vec->content_start, (vec->content_end - vec->content_start));
+    // move the contents to the back of the buffer to open up the front
+    size_t gap = vec->buffer_end - vec->content_end;
+    memmove(vec->content_start + gap, vec->content_start,
+            vec->content_end - vec->content_start);
+    vec->content_start += gap;
+    vec->content_end += gap;
   }
   vec->content_start -= vec->element_size;
   memcpy(vec->content_start, val, vec->element_size);
+  return true;
 }
 
 /// @brief Remove the first element in the vector.
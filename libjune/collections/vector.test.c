@@ -2,6 +2,7 @@
 #include "libjune/memory.h"
 #include "libjune/unit.h"
 #include <math.h>
+#include <stdio.h>
 
 static char *test_push_back_pop_back() {
   lj_vector_t vec = lj_new_vector(sizeof(int), &lj_default_allocator);
@@ -39,8 +40,41 @@ static char *test_indexing() {
   return 0;
 }
 
+static void *budget_allocate(void *state, size_t volume) {
+  size_t *budget = (size_t *)state;
+  if (*budget == 0U) {
+    return NULL;
+  }
+  (*budget)--;
+  return malloc(volume);
+}
+
+static void budget_deallocate(void *state, void *memory) { free(memory); }
+
+static char *test_allocation_failure() {
+  size_t budget = 0U;
+  lj_allocator_t allocator = {
+      .allocate_fn = &budget_allocate,
+      .deallocate_fn = &budget_deallocate,
+      .state = &budget,
+      .reallocate_fn = NULL,
+  };
+  lj_vector_t vec = lj_new_vector(sizeof(int), &allocator);
+  int val = 7;
+  lj_assert(lj_vector_capacity(&vec) == 0,
+            "a vector without a buffer should have no capacity");
+  lj_assert(!lj_vector_push_back(&vec, &val) && !lj_vector_reserve(&vec, 4),
+            "a vector that cannot allocate should report it");
+  budget = 1U;
+  lj_assert(lj_vector_push_back(&vec, &val) && lj_vector_size(&vec) == 1,
+            "a vector should grow once memory is available");
+  lj_delete_vector(&vec);
+  return 0;
+}
+
 int main(const int argc, const char **argv) {
   lj_run_test(test_push_back_pop_back);
   lj_run_test(test_indexing);
+  lj_run_test(test_allocation_failure);
   lj_finish_tests();
 }
\ No newline at end of file
@@ -0,0 +1,266 @@
+/// @file libjune/io.h
+
+#ifndef LIBJUNE_IO_H
+#define LIBJUNE_IO_H
+
+#include <libjune/collections/string.h>
+#include <libjune/memory.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/// @brief A reasonable buffer size for readers and writers.
+#define LJ_IO_DEFAULT_BUFFER_SIZE_K ((size_t)1U << 20)
+
+/// @brief Splits input into records without copying them. Data is read from a
+/// file in large blocks into one reusable buffer, or taken straight from
+/// memory such as a mapped file, and records are handed out as views into it.
+typedef struct {
+  lj_allocator_t *allocator;
+  FILE *in;
+  char *buffer;
+  size_t capacity;
+  const char *data_start;
+  const char *data_end;
+  const char *scan_from;
+  bool eof;
+  bool error;
+} lj_reader_t;
+
+/// @brief Create a reader that pulls from a file.
+/// @param in The file to read from. The reader reads in blocks itself, so
+/// making the file unbuffered with setvbuf(3) saves a copy.
+/// @param buffer_size The size of each read. The buffer grows past this if a
+/// single record does not fit.
+/// @param allocator The allocator to use.
+/// @return The new reader. If allocation failed, it reports an error on the
+/// first read.
+lj_reader_t lj_new_reader(FILE *in, size_t buffer_size,
+                          lj_allocator_t *allocator) {
+  if (buffer_size == 0U) {
+    buffer_size = LJ_IO_DEFAULT_BUFFER_SIZE_K;
+  }
+  char *buffer = (char *)lj_allocate(allocator, buffer_size);
+  return (lj_reader_t){
+      .allocator = allocator,
+      .in = in,
+      .buffer = buffer,
+      .capacity = buffer == NULL ? 0U : buffer_size,
+      .data_start = buffer,
+      .data_end = buffer,
+      .scan_from = buffer,
+      .eof = buffer == NULL,
+      .error = buffer == NULL,
+  };
+}
+
+/// @brief Create a reader over memory that is already loaded, such as the
+/// contents of a mapped vector. Nothing is copied or allocated.
+/// @param data The bytes to read.
+/// @param length The number of bytes.
+/// @return The new reader.
+lj_reader_t lj_reader_from_memory(const void *data, size_t length) {
+  return (lj_reader_t){
+      .data_start = (const char *)data,
+      .data_end = (const char *)data + length,
+      .scan_from = (const char *)data,
+      .eof = true,
+  };
+}
+
+/// @brief Delete a reader and free its buffer. The file is not closed.
+/// @param reader The reader to delete.
+void lj_reader_delete(lj_reader_t *reader) {
+  if (reader->buffer != NULL) {
+    lj_deallocate(reader->allocator, reader->buffer);
+  }
+  reader->buffer = NULL;
+  reader->data_start = reader->data_end = reader->scan_from = NULL;
+}
+
+/// @private
+/// Moves the unread tail to the front of the buffer and reads more after it,
+/// growing the buffer if the tail already fills it.
+bool lji_reader_refill(lj_reader_t *reader) {
+  size_t pending = reader->data_end - reader->data_start;
+  size_t scanned = reader->scan_from - reader->data_start;
+  if (pending == reader->capacity) {
+    char *grown = (char *)lj_reallocate(reader->allocator, reader->buffer,
+                                        reader->capacity, reader->capacity * 2U);
+    if (grown == NULL) {
+      reader->error = true;
+      return false;
+    }
+    reader->buffer = grown;
+    reader->capacity *= 2U;
+  } else {
+    memmove(reader->buffer, reader->data_start, pending);
+  }
+  size_t got = fread(reader->buffer + pending, 1, reader->capacity - pending,
+                     reader->in);
+  reader->data_start = reader->buffer;
+  reader->data_end = reader->buffer + pending + got;
+  reader->scan_from = reader->buffer + scanned;
+  if (got == 0U) {
+    reader->eof = true;
+    reader->error = ferror(reader->in) != 0;
+    return false;
+  }
+  return true;
+}
+
+/// @brief Get the next record, ending at a delimiter. A final record without a
+/// delimiter is still returned.
+/// @param reader The reader in question.
+/// @param delimiter The character that ends each record. It is not included
+/// in the view.
+/// @param out A pointer to a view to replace with the record. The view points
+/// into the reader and is valid until the next call on this reader.
+/// @return A bool; if false, the input is exhausted or an error occurred (see
+/// lj_reader_failed) and out is unchanged.
+bool lj_reader_next_record(lj_reader_t *reader, char delimiter,
+                           lj_string_view_t *out) {
+  for (;;) {
+    const char *found =
+        reader->scan_from == reader->data_end
+            ? NULL
+            : (const char *)memchr(reader->scan_from, delimiter,
+                                   reader->data_end - reader->scan_from);
+    if (found != NULL) {
+      out->start = reader->data_start;
+      out->length = found - reader->data_start;
+      reader->data_start = reader->scan_from = found + 1;
+      return true;
+    }
+    reader->scan_from = reader->data_end;
+    if (reader->eof || !lji_reader_refill(reader)) {
+      break;
+    }
+  }
+  if (reader->error || reader->data_start == reader->data_end) {
+    return false;
+  }
+  out->start = reader->data_start;
+  out->length = reader->data_end - reader->data_start;
+  reader->data_start = reader->scan_from = reader->data_end;
+  return true;
+}
+
+/// @brief Get the next line. Equivalent to lj_reader_next_record with '\n'.
+/// @param reader The reader in question.
+/// @param out A pointer to a view to replace with the line, without its
+/// newline.
+/// @return A bool; if false, the input is exhausted or an error occurred.
+bool lj_reader_next_line(lj_reader_t *reader, lj_string_view_t *out) {
+  return lj_reader_next_record(reader, '\n', out);
+}
+
+/// @brief Check if a reader stopped because of an error rather than the end
+/// of its input.
+/// @param reader The reader in question.
+/// @return A bool indicating if an error occurred.
+bool lj_reader_failed(lj_reader_t *reader) { return reader->error; }
+
+/// @brief Collects small writes into one buffer and hands them to a file in
+/// large blocks.
+typedef struct {
+  lj_allocator_t *allocator;
+  FILE *out;
+  char *buffer;
+  size_t capacity;
+  size_t used;
+  bool error;
+} lj_writer_t;
+
+/// @brief Create a writer.
+/// @param out The file to write to.
+/// @param buffer_size The number of bytes to collect before writing.
+/// @param allocator The allocator to use.
+/// @return The new writer. If allocation failed, every write goes straight to
+/// the file.
+lj_writer_t lj_new_writer(FILE *out, size_t buffer_size,
+                          lj_allocator_t *allocator) {
+  if (buffer_size == 0U) {
+    buffer_size = LJ_IO_DEFAULT_BUFFER_SIZE_K;
+  }
+  char *buffer = (char *)lj_allocate(allocator, buffer_size);
+  return (lj_writer_t){
+      .allocator = allocator,
+      .out = out,
+      .buffer = buffer,
+      .capacity = buffer == NULL ? 0U : buffer_size,
+      .used = 0U,
+      .error = false,
+  };
+}
+
+/// @brief Write out everything collected so far.
+/// @param writer The writer in question.
+/// @return A bool; if false, this or an earlier write failed.
+bool lj_writer_flush(lj_writer_t *writer) {
+  if (writer->used > 0U &&
+      fwrite(writer->buffer, 1, writer->used, writer->out) != writer->used) {
+    writer->error = true;
+  }
+  writer->used = 0U;
+  if (fflush(writer->out) != 0) {
+    writer->error = true;
+  }
+  return !writer->error;
+}
+
+/// @brief Flush a writer, then free its buffer. The file is not closed.
+/// @param writer The writer to delete.
+/// @return A bool; if false, some write failed.
+bool lj_writer_delete(lj_writer_t *writer) {
+  bool ok = lj_writer_flush(writer);
+  if (writer->buffer != NULL) {
+    lj_deallocate(writer->allocator, writer->buffer);
+  }
+  writer->buffer = NULL;
+  writer->capacity = 0U;
+  return ok;
+}
+
+/// @brief Write bytes through a writer.
+/// @param writer The writer in question.
+/// @param data The bytes to write.
+/// @param length The number of bytes.
+/// @return A bool; if false, a write to the file failed.
+bool lj_writer_write(lj_writer_t *writer, const void *data, size_t length) {
+  if (writer->used + length > writer->capacity) {
+    if (writer->used > 0U &&
+        fwrite(writer->buffer, 1, writer->used, writer->out) != writer->used) {
+      writer->error = true;
+    }
+    writer->used = 0U;
+    if (length >= writer->capacity) {
+      // too big to be worth buffering; hand it over directly
+      if (fwrite(data, 1, length, writer->out) != length) {
+        writer->error = true;
+      }
+      return !writer->error;
+    }
+  }
+  memcpy(writer->buffer + writer->used, data, length);
+  writer->used += length;
+  return !writer->error;
+}
+
+/// @brief Write a null-terminated string through a writer.
+/// @param writer The writer in question.
+/// @param str The string to write, without its terminator.
+/// @return A bool; if false, a write to the file failed.
+bool lj_writer_write_cstr(lj_writer_t *writer, const char *str) {
+  return lj_writer_write(writer, str, strlen(str));
+}
+
+/// @brief Write a string view through a writer.
+/// @param writer The writer in question.
+/// @param view The characters to write.
+/// @return A bool; if false, a write to the file failed.
+bool lj_writer_write_view(lj_writer_t *writer, lj_string_view_t view) {
+  return lj_writer_write(writer, view.start, view.length);
+}
+
+#endif
@@ -0,0 +1,74 @@
+#include <libjune/io.h>
+#include <libjune/unit.h>
+#include <stdio.h>
+
+static bool view_equals(lj_string_view_t view, const char *expected) {
+  return view.length == strlen(expected) &&
+         memcmp(view.start, expected, view.length) == 0;
+}
+
+static char *test_lines_across_reads(void) {
+  FILE *in = tmpfile();
+  fputs("alpha\nbeta\n\na line much longer than the buffer\nlast", in);
+  rewind(in);
+  lj_reader_t reader = lj_new_reader(in, 8, &lj_default_allocator);
+  lj_string_view_t line;
+  const char *expected[] = {"alpha", "beta", "",
+                            "a line much longer than the buffer", "last"};
+  for (int i = 0; i < 5; i++) {
+    lj_assert(lj_reader_next_line(&reader, &line), "a line should be read");
+    lj_assert(view_equals(line, expected[i]),
+              "lines should survive crossing buffer boundaries");
+  }
+  lj_assert(!lj_reader_next_line(&reader, &line),
+            "reading past the end should return false");
+  lj_assert(!lj_reader_failed(&reader), "reaching the end is not an error");
+  lj_reader_delete(&reader);
+  fclose(in);
+  return 0;
+}
+
+static char *test_memory_records(void) {
+  const char data[] = "a,bb,,ccc,";
+  lj_reader_t reader = lj_reader_from_memory(data, sizeof(data) - 1);
+  lj_string_view_t record;
+  const char *expected[] = {"a", "bb", "", "ccc"};
+  for (int i = 0; i < 4; i++) {
+    lj_assert(lj_reader_next_record(&reader, ',', &record),
+              "a record should be read");
+    lj_assert(view_equals(record, expected[i]), "records should match");
+    lj_assert(record.start >= data && record.start < data + sizeof(data),
+              "records from memory should not be copied");
+  }
+  lj_assert(!lj_reader_next_record(&reader, ',', &record),
+            "a trailing delimiter should not produce an empty record");
+  lj_reader_delete(&reader);
+  return 0;
+}
+
+static char *test_writer(void) {
+  FILE *out = tmpfile();
+  lj_writer_t writer = lj_new_writer(out, 16, &lj_default_allocator);
+  lj_assert(lj_writer_write_cstr(&writer, "hello, "), "writing should succeed");
+  lj_assert(ftell(out) == 0, "small writes should stay in the buffer");
+  lj_string_view_t view = {"world and then some more text", 5};
+  lj_writer_write_view(&writer, view);
+  lj_writer_write_cstr(&writer, "! this one is longer than the buffer");
+  lj_assert(lj_writer_delete(&writer), "flushing should succeed");
+  char buffer[64] = {0};
+  rewind(out);
+  fread(buffer, 1, sizeof(buffer) - 1, out);
+  fclose(out);
+  lj_assert(strcmp(buffer, "hello, world! this one is longer than the buffer") ==
+                0,
+            "writes should come out in order");
+  return 0;
+}
+
+int main(const int argc, const char **argv) {
+  lj_run_test(test_lines_across_reads);
+  lj_run_test(test_memory_records);
+  lj_run_test(test_writer);
+  lj_finish_tests();
+  return 0;
+}
@@ -4,6 +4,7 @@
 #define LIBJUNE_LOGGING_H
 
 #include <libjune/collections/string.h>
+#include <libjune/io.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
@@ -20,21 +21,37 @@ typedef enum {
 } lj_loglevel_t;
 
 /// @private
-const char *LJI_LOGLEVEL_NAMES[] = {
+const char *LJI_LOGLEVEL_NAMES_K[] = {
     "TRACE", "INFO", "DEBUG", "WARN", "ERROR", "FATAL",
 };
 
-/// @brief Object representing a log output.
+/// @brief Object representing a log output. If writer is set, messages go
+/// through it and reach the file whenever it flushes; otherwise each message is
+/// written and flushed to out immediately.
 typedef struct {
   const char *format;
   lj_loglevel_t loglevel;
   FILE *out;
+  lj_writer_t *writer;
 } lj_logger_t;
 
+/// @private
+/// Appends a whole C string with one reserve and one copy.
+void lji_logger_push_cstr(lj_string_t *str, const char *cstr) {
+  size_t length = strlen(cstr);
+  size_t used = str->content_end - str->buffer_start;
+  if (!lj_vector_reserve(str, used + length)) {
+    return;
+  }
+  // the copy overwrites the old terminator and brings its own
+  memcpy(str->content_end - 1, cstr, length + 1U);
+  str->content_end += length;
+}
+
 /// @private
 lj_string_t lji_logger_format(const char *format, const char *message,
                               const struct tm *gmt, lj_loglevel_t level) {
-  lj_string_t res = lj_string_new();
+  lj_string_t res = lj_string_new(&lj_default_allocator);
   const char *cursor = format;
   while (*cursor != '\0') {
     if (*cursor == '$') {
@@ -67,10 +84,10 @@ lj_string_t lji_logger_format(const char *format, const char *message,
         lj_string_push_back(&res, '0' + (gmt->tm_sec + 1) % 10);
         break;
       case 'l':
-        lj_str_pushstr(&res, LJI_LOGLEVEL_NAMES_K[level]);
+        lji_logger_push_cstr(&res, LJI_LOGLEVEL_NAMES_K[level]);
         break;
       case 'n':
-        lj_str_pushstr(&res, message);
+        lji_logger_push_cstr(&res, message);
         break;
       case '$':
         lj_string_push_back(&res, '$');
@@ -96,9 +113,15 @@ void lj_log(lj_logger_t *logger, lj_loglevel_t level, const char *message) {
   const time_t now = time(NULL);
   lj_string_t formatted =
       lji_logger_format(logger->format, message, gmtime(&now), level);
-  fputs(formatted.begin, logger->out);
-  fputs("\n", logger->out);
-  fflush(logger->out);
+  if (logger->writer != NULL) {
+    lj_string_push_back(&formatted, '\n');
+    lj_writer_write(logger->writer, lj_string_to_cstr(&formatted),
+                    lj_string_length(&formatted));
+  } else {
+    fputs(lj_string_to_cstr(&formatted), logger->out);
+    fputs("\n", logger->out);
+    fflush(logger->out);
+  }
   lj_string_delete(&formatted);
 }
 
@@ -1,24 +1,55 @@
 #include "../libjune/logging.h"
+#include "../libjune/unit.h"
 #include <stdio.h>
 
+static char *test_writer_output(void) {
+    FILE *out = tmpfile();
+    lj_writer_t writer = lj_new_writer(out, 4096, &lj_default_allocator);
+    lj_logger_t logger = (lj_logger_t) {
+        .format = "$l: $n",
+        .loglevel = LJ_LOG_WARN,
+        .writer = &writer,
+    };
+    char long_message[301];
+    memset(long_message, 'x', 300);
+    long_message[300] = '\0';
+    lj_log(&logger, LJ_LOG_WARN, "first");
+    lj_log(&logger, LJ_LOG_INFO, "filtered out");
+    lj_log(&logger, LJ_LOG_ERROR, long_message);
+    lj_assert(ftell(out) == 0, "messages should wait in the writer's buffer");
+    lj_assert(lj_writer_delete(&writer), "flushing should succeed");
+    char buffer[512] = {0};
+    rewind(out);
+    size_t got = fread(buffer, 1, sizeof(buffer) - 1, out);
+    fclose(out);
+    char expected[512];
+    snprintf(expected, sizeof(expected), "WARN: first\nERROR: %s\n",
+             long_message);
+    lj_assert(got == strlen(expected) && strcmp(buffer, expected) == 0,
+              "messages should come out formatted, in order and one per line");
+    return 0;
+}
+
 int main(const int argc, const char** argv) {
-    const lj_logger_t def = (lj_logger_t) {
+    lj_logger_t def = (lj_logger_t) {
         .format = "[$M/$D/$Y $h:$m:$s $l]\t$n",
         .loglevel = LJ_LOG_FATAL,
         .out = stdout,
     };
-    lj_log(def, LJ_LOG_DEBUG, "log level checking failure");
-    lj_log(def, LJ_LOG_FATAL, "log level checking success (maybe)");
+    lj_log(&def, LJ_LOG_DEBUG, "log level checking failure");
+    lj_log(&def, LJ_LOG_FATAL, "log level checking success (maybe)");
 
-    lj_log(def, LJ_LOG_FATAL, "this should just. work.\n");
-    lj_log(def, LJ_LOG_FATAL, "the next one should be an assertion failure\n");
+    lj_log(&def, LJ_LOG_FATAL, "this should just. work.\n");
+    lj_log(&def, LJ_LOG_FATAL, "the next one should be an assertion failure\n");
 
-    const lj_logger_t alt = (lj_logger_t) {
+    lj_logger_t alt = (lj_logger_t) {
         .format = "[$M/$D/$Y $h:$m:$s $l]\t$n $q ",
         .loglevel = LJ_LOG_INFO,
         .out = stdout,
     };
-    lj_log(alt, LJ_LOG_FATAL, "format specifier checking failure");
+    lj_log(&alt, LJ_LOG_FATAL, "format specifier checking failure");
 
+    lj_run_test(test_writer_output);
+    lj_finish_tests();
     return 0;
 }
\ No newline at end of file
@@ -4,13 +4,20 @@
 #define LIBJUNE_MEMORY_H
 
 #include <stdlib.h>
+#include <string.h>
+
+/// @brief Assumed size of a cache line, used to keep data written by different
+/// threads apart.
+#define LJ_CACHE_LINE_SIZE_K 64U
 
 /// @brief Type used to represent an allocator in an implementation-agnostic
-/// way.
+/// way. reallocate_fn may be NULL, in which case resizing falls back to
+/// allocate, copy and deallocate.
 typedef struct lj_allocator_t {
   void *(*allocate_fn)(void *, size_t);
   void (*deallocate_fn)(void *, void *);
   void *state;
+  void *(*reallocate_fn)(void *, void *, size_t);
 } lj_allocator_t;
 
 /// @brief Allocate memory from an allocator. If no memory is available or the
@@ -31,6 +38,27 @@ void lj_deallocate(lj_allocator_t *allocator, void *memory) {
   allocator->deallocate_fn(allocator->state, memory);
 }
 
+/// @brief Resize memory previously allocated using an allocator, keeping its
+/// contents up to the smaller of the two sizes. The memory may move.
+/// @param allocator The allocator in question.
+/// @param memory The memory to resize. If NULL, this is just an allocation.
+/// @param old_volume The current size of the memory in bytes.
+/// @param volume The new size in bytes.
+/// @return A pointer to the resized memory, or NULL if resizing failed, in
+/// which case the original memory is untouched.
+void *lj_reallocate(lj_allocator_t *allocator, void *memory, size_t old_volume,
+                    size_t volume) {
+  if (allocator->reallocate_fn != NULL) {
+    return allocator->reallocate_fn(allocator->state, memory, volume);
+  }
+  void *result = lj_allocate(allocator, volume);
+  if (result != NULL && memory != NULL) {
+    memcpy(result, memory, old_volume < volume ? old_volume : volume);
+    lj_deallocate(allocator, memory);
+  }
+  return result;
+}
+
 ///@private
 typedef struct {
   char *buffer_start;
@@ -85,11 +113,17 @@ void *lji_default_allocate_fn(void *state, size_t volume) {
 /// @private
 void lji_default_deallocate_fn(void *state, void *memory) { free(memory); }
 
-/// @brief Default allocator. Uses libc malloc(1) and free(1).
+/// @private
+void *lji_default_reallocate_fn(void *state, void *memory, size_t volume) {
+  return realloc(memory, volume);
+}
+
+/// @brief Default allocator. Uses libc malloc(1), realloc(1) and free(1).
 static lj_allocator_t lj_default_allocator = (lj_allocator_t) {
     .allocate_fn = &lji_default_allocate_fn,
     .deallocate_fn = &lji_default_deallocate_fn,
     .state = NULL,
+    .reallocate_fn = &lji_default_reallocate_fn,
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,340 @@
+/// @file libjune/memory_map.h
+
+#ifndef LIBJUNE_MEMORY_MAP_H
+#define LIBJUNE_MEMORY_MAP_H
+
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "libjune/memory_map.h requires a POSIX system with mmap(2)"
+#endif
+
+// glibc hides some of what follows (ftruncate, MAP_ANONYMOUS, mremap) under
+// strict -std modes; define _DEFAULT_SOURCE or _GNU_SOURCE before including
+// anything if that bites.
+#include <fcntl.h>
+#include <libjune/collections/vector.h>
+#include <libjune/memory.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+/// @private
+/// Bookkeeping stored in front of every anonymous mapping; keeps the memory
+/// handed out aligned to a cache line.
+#define LJI_MMAP_HEADER_SIZE_K LJ_CACHE_LINE_SIZE_K
+
+/// @private
+#define LJI_HUGE_PAGE_SIZE_K ((size_t)2U * 1024U * 1024U)
+
+/// @private
+static char lji_mmap_huge_pages_marker;
+
+/// @private
+void *lji_mmap_allocate_fn(void *state, size_t volume) {
+  bool huge_pages = state != NULL;
+  size_t length = volume + LJI_MMAP_HEADER_SIZE_K;
+  void *base = MAP_FAILED;
+  if (huge_pages) {
+    length = (length + LJI_HUGE_PAGE_SIZE_K - 1U) / LJI_HUGE_PAGE_SIZE_K *
+             LJI_HUGE_PAGE_SIZE_K;
+#ifdef MAP_HUGETLB
+    base = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+  }
+  if (base == MAP_FAILED) {
+    base = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+      return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (huge_pages) {
+      // no reserved huge pages; ask for transparent ones instead
+      madvise(base, length, MADV_HUGEPAGE);
+    }
+#endif
+  }
+  *(size_t *)base = length;
+  return (char *)base + LJI_MMAP_HEADER_SIZE_K;
+}
+
+/// @private
+void lji_mmap_deallocate_fn(void *state, void *memory) {
+  if (memory == NULL) {
+    return;
+  }
+  char *base = (char *)memory - LJI_MMAP_HEADER_SIZE_K;
+  munmap(base, *(size_t *)base);
+}
+
+/// @private
+void *lji_mmap_reallocate_fn(void *state, void *memory, size_t volume) {
+  if (memory == NULL) {
+    return lji_mmap_allocate_fn(state, volume);
+  }
+  char *base = (char *)memory - LJI_MMAP_HEADER_SIZE_K;
+  size_t old_length = *(size_t *)base;
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+  if (state == NULL) {
+    size_t length = volume + LJI_MMAP_HEADER_SIZE_K;
+    void *moved = mremap(base, old_length, length, MREMAP_MAYMOVE);
+    if (moved == MAP_FAILED) {
+      return NULL;
+    }
+    *(size_t *)moved = length;
+    return (char *)moved + LJI_MMAP_HEADER_SIZE_K;
+  }
+#endif
+  char *result = (char *)lji_mmap_allocate_fn(state, volume);
+  if (result == NULL) {
+    return NULL;
+  }
+  size_t old_volume = old_length - LJI_MMAP_HEADER_SIZE_K;
+  memcpy(result, memory, old_volume < volume ? old_volume : volume);
+  munmap(base, old_length);
+  return result;
+}
+
+/// @brief Create an allocator that gives every allocation its own anonymous
+/// memory mapping. Worth it for large, long-lived buffers: memory goes straight
+/// back to the system when freed, and on Linux growing a buffer remaps pages
+/// instead of copying them. The allocator holds no state and needs no
+/// deleting.
+/// @param huge_pages Whether to back allocations with huge pages. Reserved
+/// huge pages are tried first, then transparent huge pages, then normal pages.
+/// @return The new allocator.
+lj_allocator_t lj_mmap_allocator_new(bool huge_pages) {
+  return (lj_allocator_t){
+      .allocate_fn = &lji_mmap_allocate_fn,
+      .deallocate_fn = &lji_mmap_deallocate_fn,
+      // any non-NULL state marks a huge page allocator
+      .state = huge_pages ? (void *)&lji_mmap_huge_pages_marker : NULL,
+      .reallocate_fn = &lji_mmap_reallocate_fn,
+  };
+}
+
+/// @brief Access pattern hints for a mapped vector.
+typedef enum {
+  LJ_MAP_ADVICE_NORMAL,
+  LJ_MAP_ADVICE_SEQUENTIAL,
+  LJ_MAP_ADVICE_RANDOM,
+  LJ_MAP_ADVICE_WILLNEED,
+} lj_map_advice_t;
+
+/// @private
+#define LJI_MAPPED_MAGIC_K 0x6C6A766563746F72ULL
+
+/// @private
+/// Files start with this header, padded out to a cache line; elements follow.
+typedef struct {
+  uint64_t magic;
+  uint64_t element_size;
+  uint64_t count;
+} lji_mapped_header_t;
+
+/// @private
+#define LJI_MAPPED_HEADER_SIZE_K LJ_CACHE_LINE_SIZE_K
+
+/// @private
+typedef struct {
+  lj_allocator_t allocator;
+  int fd;
+  char *base;
+  size_t mapped_length;
+  bool writable;
+} lji_mapped_file_t;
+
+/// @private
+void *lji_mapped_allocate_fn(void *state, size_t volume) { return NULL; }
+
+/// @private
+void lji_mapped_deallocate_fn(void *state, void *memory) { return; }
+
+/// @private
+void *lji_mapped_reallocate_fn(void *state, void *memory, size_t volume) {
+  lji_mapped_file_t *file = (lji_mapped_file_t *)state;
+  size_t length = LJI_MAPPED_HEADER_SIZE_K + volume;
+  if (!file->writable || ftruncate(file->fd, (off_t)length) != 0) {
+    return NULL;
+  }
+#if defined(__linux__) && defined(MREMAP_MAYMOVE)
+  void *base = mremap(file->base, file->mapped_length, length, MREMAP_MAYMOVE);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+#else
+  void *base =
+      mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, file->fd, 0);
+  if (base == MAP_FAILED) {
+    return NULL;
+  }
+  munmap(file->base, file->mapped_length);
+#endif
+  file->base = (char *)base;
+  file->mapped_length = length;
+  return file->base + LJI_MAPPED_HEADER_SIZE_K;
+}
+
+/// @brief Open a file as a vector whose buffer is a memory mapping of the
+/// file, so its contents are paged in on demand instead of read up front. The
+/// usual vector functions work on the result. A new file is created when
+/// writable is true and the path does not exist.
+/// @param path The file to map.
+/// @param element_size The result of sizeof(element). Must match the size the
+/// file was written with.
+/// @param writable If false, the mapping is read-only: elements must not be
+/// changed, and anything that would grow the vector, such as lj_vector_reserve
+/// or lj_vector_push_back, fails and reports it. If true, changes go to the
+/// file and growing the vector grows the file.
+/// @param advice A hint about how the elements will be accessed.
+/// @param out A pointer to a vector object to replace with the result. Any
+/// existing vector at this pointer will not be deleted by this.
+/// @return A bool; if false, the file could not be opened or mapped or was not
+/// written with this element size, or element_size was 0, and out is
+/// unchanged.
+bool lj_vector_map_file(const char *path, size_t element_size, bool writable,
+                        lj_map_advice_t advice, lj_vector_t *out) {
+  if (element_size == 0U) {
+    return false;
+  }
+  int fd = writable ? open(path, O_RDWR | O_CREAT, 0644) : open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  lji_mapped_header_t header;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return false;
+  }
+  size_t length = (size_t)info.st_size;
+  if (length == 0U && writable) {
+    // brand new file; give it a header and room for a few elements
+    length = LJI_MAPPED_HEADER_SIZE_K + LJI_BUFFER_INITIAL_SIZE * element_size;
+    header = (lji_mapped_header_t){LJI_MAPPED_MAGIC_K, element_size, 0U};
+    if (ftruncate(fd, (off_t)length) != 0 ||
+        pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+      close(fd);
+      return false;
+    }
+  } else if (length < LJI_MAPPED_HEADER_SIZE_K ||
+             pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+             header.magic != LJI_MAPPED_MAGIC_K ||
+             header.element_size != element_size ||
+             header.count > (length - LJI_MAPPED_HEADER_SIZE_K) / element_size) {
+    close(fd);
+    return false;
+  }
+  char *base = (char *)mmap(NULL, length,
+                            writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                            MAP_SHARED, fd, 0);
+  if (base == (char *)MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+  int hint = advice == LJ_MAP_ADVICE_SEQUENTIAL ? POSIX_MADV_SEQUENTIAL
+             : advice == LJ_MAP_ADVICE_RANDOM   ? POSIX_MADV_RANDOM
+             : advice == LJ_MAP_ADVICE_WILLNEED ? POSIX_MADV_WILLNEED
+                                                : POSIX_MADV_NORMAL;
+  posix_madvise(base, length, hint);
+  lji_mapped_file_t *file = (lji_mapped_file_t *)lj_allocate(
+      &lj_default_allocator, sizeof(lji_mapped_file_t));
+  if (file == NULL) {
+    munmap(base, length);
+    close(fd);
+    return false;
+  }
+  *file = (lji_mapped_file_t){
+      .allocator =
+          {
+              .allocate_fn = &lji_mapped_allocate_fn,
+              .deallocate_fn = &lji_mapped_deallocate_fn,
+              .state = file,
+              .reallocate_fn = &lji_mapped_reallocate_fn,
+          },
+      .fd = fd,
+      .base = base,
+      .mapped_length = length,
+      .writable = writable,
+  };
+  char *buffer = base + LJI_MAPPED_HEADER_SIZE_K;
+  char *content_end = buffer + header.count * element_size;
+  // any slack past the last element is not writable in a read-only mapping,
+  // so leave none and every push has to go through the failing grow
+  *out = (lj_vector_t){
+      .allocator = &file->allocator,
+      .element_size = element_size,
+      .content_start = buffer,
+      .content_end = content_end,
+      .buffer_start = buffer,
+      .buffer_end = writable ? base + length : content_end,
+  };
+  return true;
+}
+
+/// @brief Check whether a vector came from lj_vector_map_file.
+/// @param vec The vector in question.
+/// @return A bool indicating if the vector is backed by a mapped file.
+bool lj_vector_is_mapped(lj_vector_t *vec) {
+  return vec->allocator != NULL &&
+         vec->allocator->reallocate_fn == &lji_mapped_reallocate_fn;
+}
+
+/// @brief Record a mapped vector's element count in its file and write its
+/// contents back to disk. Elements before content_start are dropped first, so
+/// the file always starts with the first element. Does nothing for read-only
+/// mappings.
+/// @param vec The mapped vector in question.
+/// @return A bool; if false, the vector is not mapped or the write failed.
+bool lj_vector_sync_file(lj_vector_t *vec) {
+  if (!lj_vector_is_mapped(vec)) {
+    return false;
+  }
+  lji_mapped_file_t *file = (lji_mapped_file_t *)vec->allocator->state;
+  if (!file->writable) {
+    return true;
+  }
+  size_t content_length = vec->content_end - vec->content_start;
+  if (vec->content_start != vec->buffer_start) {
+    memmove(vec->buffer_start, vec->content_start, content_length);
+    vec->content_start = vec->buffer_start;
+    vec->content_end = vec->buffer_start + content_length;
+  }
+  lji_mapped_header_t *header = (lji_mapped_header_t *)file->base;
+  header->count = content_length / vec->element_size;
+  return msync(file->base, file->mapped_length, MS_SYNC) == 0;
+}
+
+/// @brief Sync, unmap and close a mapped vector. Use this instead of
+/// lj_delete_vector for vectors from lj_vector_map_file. Writable files are
+/// trimmed to exactly fit their elements.
+/// @param vec The mapped vector to close.
+/// @return A bool; if false, the final sync failed or the vector is not
+/// mapped. The vector is closed either way unless it was not mapped.
+bool lj_vector_unmap_file(lj_vector_t *vec) {
+  if (!lj_vector_is_mapped(vec)) {
+    return false;
+  }
+  lji_mapped_file_t *file = (lji_mapped_file_t *)vec->allocator->state;
+  bool synced = lj_vector_sync_file(vec);
+  size_t final_length =
+      LJI_MAPPED_HEADER_SIZE_K + (vec->content_end - vec->content_start);
+  munmap(file->base, file->mapped_length);
+  if (file->writable && ftruncate(file->fd, (off_t)final_length) != 0) {
+    synced = false;
+  }
+  close(file->fd);
+  lj_deallocate(&lj_default_allocator, file);
+  vec->content_start = vec->content_end = vec->buffer_start = vec->buffer_end =
+      NULL;
+  return synced;
+}
+
+#endif
@@ -0,0 +1,107 @@
+#define _DEFAULT_SOURCE
+#include <libjune/memory_map.h>
+#include <libjune/unit.h>
+#include <stdio.h>
+
+static char *test_mmap_allocator(void) {
+  lj_allocator_t allocator = lj_mmap_allocator_new(false);
+  lj_vector_t vec = lj_new_vector(sizeof(long), &allocator);
+  for (long i = 0; i < 100000; i++) {
+    lj_vector_push_back(&vec, &i);
+  }
+  long last;
+  lj_assert(lj_vector_get(&vec, 99999, &last) && last == 99999,
+            "a vector should grow normally on mapped memory");
+  lj_delete_vector(&vec);
+  lj_allocator_t huge = lj_mmap_allocator_new(true);
+  char *buffer = (char *)lj_allocate(&huge, 100);
+  lj_assert(buffer != NULL, "huge page allocations should fall back");
+  buffer[99] = 1;
+  lj_deallocate(&huge, buffer);
+  return 0;
+}
+
+static char *test_file_round_trip(void) {
+  char path[] = "/tmp/libjune_memory_map_XXXXXX";
+  int fd = mkstemp(path);
+  close(fd);
+  unlink(path);
+  lj_vector_t vec;
+  lj_assert(lj_vector_map_file(path, sizeof(int), true,
+                               LJ_MAP_ADVICE_NORMAL, &vec),
+            "creating a new mapped file should succeed");
+  for (int i = 0; i < 5000; i++) {
+    lj_vector_push_back(&vec, &i);
+  }
+  lj_vector_pop_front(&vec, NULL);
+  lj_assert(lj_vector_sync_file(&vec), "syncing should succeed");
+  lj_assert(lj_vector_unmap_file(&vec), "closing should succeed");
+
+  lj_assert(!lj_vector_map_file(path, sizeof(long), false,
+                                LJ_MAP_ADVICE_NORMAL, &vec),
+            "a different element size should be rejected");
+  lj_assert(lj_vector_map_file(path, sizeof(int), false,
+                               LJ_MAP_ADVICE_SEQUENTIAL, &vec),
+            "reopening read-only should succeed");
+  lj_assert(lj_vector_size(&vec) == 4999, "the count should be kept");
+  int first;
+  lj_vector_get(&vec, 0, &first);
+  lj_assert(first == 1, "the popped element should not come back");
+  lj_assert(!lj_vector_reserve(&vec, lj_vector_capacity(&vec) + 1),
+            "a read-only mapping should refuse to grow");
+  int extra = 5000;
+  lj_assert(lj_vector_size(&vec) == lj_vector_capacity(&vec) &&
+                !lj_vector_push_back(&vec, &extra) &&
+                lj_vector_size(&vec) == 4999,
+            "pushing onto a full read-only mapping should fail cleanly");
+  lj_vector_unmap_file(&vec);
+
+  lj_assert(lj_vector_map_file(path, sizeof(int), true,
+                               LJ_MAP_ADVICE_WILLNEED, &vec),
+            "reopening read-write should succeed");
+  lj_assert(lj_vector_push_back(&vec, &extra) && lj_vector_size(&vec) == 5000,
+            "a reopened file should be able to grow");
+  lj_vector_unmap_file(&vec);
+  unlink(path);
+  return 0;
+}
+
+static char *test_read_only_slack(void) {
+  char path[] = "/tmp/libjune_memory_map_XXXXXX";
+  int fd = mkstemp(path);
+  close(fd);
+  unlink(path);
+  lj_vector_t vec;
+  lj_assert(!lj_vector_map_file(path, 0, true, LJ_MAP_ADVICE_NORMAL, &vec),
+            "a zero element size should be rejected");
+  lj_assert(lj_vector_map_file(path, sizeof(int), true,
+                               LJ_MAP_ADVICE_NORMAL, &vec),
+            "creating a new mapped file should succeed");
+  int value = 1;
+  lj_vector_push_back(&vec, &value);
+  lj_assert(lj_vector_sync_file(&vec), "syncing should succeed");
+  // open a second, read-only view while the file still has room to spare
+  lj_vector_t view;
+  lj_assert(lj_vector_map_file(path, sizeof(int), false,
+                               LJ_MAP_ADVICE_NORMAL, &view),
+            "a file with slack should open read-only");
+  lj_assert(lj_vector_size(&view) == 1 &&
+                lj_vector_capacity(&view) == lj_vector_size(&view),
+            "a read-only mapping should have no spare capacity");
+  lj_assert(!lj_vector_push_back(&view, &value) &&
+                !lj_vector_push_front(&view, &value) &&
+                lj_vector_size(&view) == 1,
+            "pushing onto a read-only mapping should fail, not write");
+  lj_vector_unmap_file(&view);
+  lj_vector_unmap_file(&vec);
+  unlink(path);
+  return 0;
+}
+
+int main(const int argc, const char **argv) {
+  lj_run_test(test_mmap_allocator);
+  lj_run_test(test_file_round_trip);
+  lj_run_test(test_read_only_slack);
+  lj_finish_tests();
+  return 0;
+}
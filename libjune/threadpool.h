@@ -0,0 +1,606 @@
+/// @file libjune/threadpool.h
+
+#ifndef LIBJUNE_THREADPOOL_H
+#define LIBJUNE_THREADPOOL_H
+
+#if !defined(__STDC_VERSION__) || __STDC_VERSION__ < 201112L ||               \
+    defined(__STDC_NO_ATOMICS__) || defined(__STDC_NO_THREADS__)
+#error "libjune/threadpool.h requires C11 atomics and threads"
+#endif
+
+#include <libjune/collections/mpmc_queue.h>
+#include <libjune/collections/vector.h>
+#include <libjune/memory.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+/// @brief Number of tasks each worker can hold before new ones run inline.
+#define LJ_THREADPOOL_DEQUE_CAPACITY_K 4096U
+
+/// @brief Number of tasks non-worker threads can queue up before new ones run
+/// inline.
+#define LJ_THREADPOOL_INBOX_CAPACITY_K 4096U
+
+/// @brief Signature of a task body.
+typedef void (*lj_task_fn_t)(void *ctx);
+
+/// @brief Counts the tasks submitted against it that have yet to finish. Wait
+/// on it with lj_threadpool_wait.
+typedef struct {
+  atomic_size_t pending;
+} lj_task_counter_t;
+
+/// @brief Create a new counter with nothing pending.
+/// @return The new counter.
+lj_task_counter_t lj_new_task_counter(void) {
+  lj_task_counter_t counter;
+  atomic_init(&counter.pending, 0U);
+  return counter;
+}
+
+/// @private
+typedef struct {
+  lj_task_fn_t fn;
+  void *ctx;
+  lj_task_counter_t *counter;
+} lji_task_t;
+
+/// @private
+typedef struct {
+  _Atomic(lj_task_fn_t) fn;
+  _Atomic(void *) ctx;
+  _Atomic(lj_task_counter_t *) counter;
+} lji_task_slot_t;
+
+/// @private
+/// A Chase-Lev deque; the owner pushes and takes at the bottom, thieves steal
+/// from the top.
+typedef struct {
+  atomic_ptrdiff_t top;
+  char padding0[LJ_CACHE_LINE_SIZE_K];
+  atomic_ptrdiff_t bottom;
+  char padding1[LJ_CACHE_LINE_SIZE_K];
+  lji_task_slot_t slots[LJ_THREADPOOL_DEQUE_CAPACITY_K];
+  struct lj_threadpool_t *pool;
+  thrd_t thread;
+  size_t index;
+  size_t rng;
+} lji_threadpool_worker_t;
+
+/// @brief A fixed set of worker threads that share tasks by work stealing.
+typedef struct lj_threadpool_t {
+  lj_allocator_t *allocator;
+  size_t worker_count;
+  lji_threadpool_worker_t *workers;
+  lj_mpmc_queue_t inbox;
+  atomic_bool running;
+  atomic_int sleepers;
+  mtx_t sleep_lock;
+  cnd_t wake;
+} lj_threadpool_t;
+
+/// @private
+static _Thread_local lji_threadpool_worker_t *lji_threadpool_current_worker =
+    NULL;
+
+/// @private
+bool lji_deque_push(lji_threadpool_worker_t *worker, lji_task_t task) {
+  ptrdiff_t bottom =
+      atomic_load_explicit(&worker->bottom, memory_order_relaxed);
+  ptrdiff_t top = atomic_load_explicit(&worker->top, memory_order_acquire);
+  if (bottom - top >= (ptrdiff_t)LJ_THREADPOOL_DEQUE_CAPACITY_K) {
+    return false;
+  }
+  lji_task_slot_t *slot =
+      &worker->slots[(size_t)bottom & (LJ_THREADPOOL_DEQUE_CAPACITY_K - 1U)];
+  atomic_store_explicit(&slot->fn, task.fn, memory_order_relaxed);
+  atomic_store_explicit(&slot->ctx, task.ctx, memory_order_relaxed);
+  atomic_store_explicit(&slot->counter, task.counter, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_relaxed);
+  return true;
+}
+
+/// @private
+void lji_deque_read(lji_threadpool_worker_t *worker, ptrdiff_t index,
+                    lji_task_t *out) {
+  lji_task_slot_t *slot =
+      &worker->slots[(size_t)index & (LJ_THREADPOOL_DEQUE_CAPACITY_K - 1U)];
+  out->fn = atomic_load_explicit(&slot->fn, memory_order_relaxed);
+  out->ctx = atomic_load_explicit(&slot->ctx, memory_order_relaxed);
+  out->counter = atomic_load_explicit(&slot->counter, memory_order_relaxed);
+}
+
+/// @private
+bool lji_deque_take(lji_threadpool_worker_t *worker, lji_task_t *out) {
+  ptrdiff_t bottom =
+      atomic_load_explicit(&worker->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&worker->bottom, bottom, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  ptrdiff_t top = atomic_load_explicit(&worker->top, memory_order_relaxed);
+  if (top > bottom) {
+    atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_relaxed);
+    return false;
+  }
+  lji_deque_read(worker, bottom, out);
+  if (top == bottom) {
+    bool won = atomic_compare_exchange_strong_explicit(
+        &worker->top, &top, top + 1, memory_order_seq_cst,
+        memory_order_relaxed);
+    atomic_store_explicit(&worker->bottom, bottom + 1, memory_order_relaxed);
+    return won;
+  }
+  return true;
+}
+
+/// @private
+bool lji_deque_steal(lji_threadpool_worker_t *worker, lji_task_t *out) {
+  ptrdiff_t top = atomic_load_explicit(&worker->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  ptrdiff_t bottom =
+      atomic_load_explicit(&worker->bottom, memory_order_acquire);
+  if (top >= bottom) {
+    return false;
+  }
+  lji_deque_read(worker, top, out);
+  return atomic_compare_exchange_strong_explicit(&worker->top, &top, top + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed);
+}
+
+/// @private
+void lji_threadpool_run(lji_task_t *task) {
+  task->fn(task->ctx);
+  if (task->counter != NULL) {
+    atomic_fetch_sub_explicit(&task->counter->pending, 1U,
+                              memory_order_release);
+  }
+}
+
+/// @private
+/// Finds one runnable task: the caller's own deque first, then the inbox, then
+/// a random victim's deque.
+bool lji_threadpool_find(lj_threadpool_t *pool, lji_threadpool_worker_t *self,
+                         lji_task_t *out) {
+  if (self != NULL && lji_deque_take(self, out)) {
+    return true;
+  }
+  if (lj_mpmc_queue_dequeue(&pool->inbox, out)) {
+    return true;
+  }
+  size_t start = 0U;
+  if (self != NULL) {
+    self->rng ^= self->rng << 13;
+    self->rng ^= self->rng >> 7;
+    self->rng ^= self->rng << 17;
+    start = self->rng;
+  }
+  for (size_t i = 0; i < pool->worker_count; i++) {
+    lji_threadpool_worker_t *victim =
+        &pool->workers[(start + i) % pool->worker_count];
+    if (victim != self && lji_deque_steal(victim, out)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// @private
+int lji_threadpool_worker_main(void *arg) {
+  lji_threadpool_worker_t *self = (lji_threadpool_worker_t *)arg;
+  lj_threadpool_t *pool = self->pool;
+  lji_threadpool_current_worker = self;
+  size_t idle_rounds = 0U;
+  lji_task_t task;
+  while (atomic_load_explicit(&pool->running, memory_order_acquire)) {
+    if (lji_threadpool_find(pool, self, &task)) {
+      lji_threadpool_run(&task);
+      idle_rounds = 0U;
+    } else if (++idle_rounds < 64U) {
+      thrd_yield();
+    } else {
+      // nap briefly; a submitter wakes us early if it sees we're asleep
+      struct timespec deadline;
+      timespec_get(&deadline, TIME_UTC);
+      deadline.tv_nsec += 1000000L;
+      if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+      }
+      mtx_lock(&pool->sleep_lock);
+      atomic_fetch_add(&pool->sleepers, 1);
+      if (atomic_load_explicit(&pool->running, memory_order_acquire)) {
+        cnd_timedwait(&pool->wake, &pool->sleep_lock, &deadline);
+      }
+      atomic_fetch_sub(&pool->sleepers, 1);
+      mtx_unlock(&pool->sleep_lock);
+    }
+  }
+  lji_threadpool_current_worker = NULL;
+  return 0;
+}
+
+/// @private
+void lji_threadpool_stop(lj_threadpool_t *pool, size_t started) {
+  mtx_lock(&pool->sleep_lock);
+  atomic_store_explicit(&pool->running, false, memory_order_release);
+  cnd_broadcast(&pool->wake);
+  mtx_unlock(&pool->sleep_lock);
+  for (size_t i = 0; i < started; i++) {
+    thrd_join(pool->workers[i].thread, NULL);
+  }
+  lj_mpmc_queue_delete(&pool->inbox);
+  mtx_destroy(&pool->sleep_lock);
+  cnd_destroy(&pool->wake);
+  lj_allocator_t *allocator = pool->allocator;
+  lj_deallocate(allocator, pool->workers);
+  lj_deallocate(allocator, pool);
+}
+
+/// @brief Delete a thread pool, stopping and joining its workers. Tasks that
+/// have not started yet are dropped; wait on their counters first to avoid
+/// this.
+/// @param pool The pool to delete.
+void lj_threadpool_delete(lj_threadpool_t *pool) {
+  lji_threadpool_stop(pool, pool->worker_count);
+}
+
+/// @brief Create a new thread pool and start its workers.
+/// @param worker_count The number of worker threads to start. Must be at least
+/// 1.
+/// @param allocator The allocator to use. The pool and the parallel vector
+/// operations allocate from it on the calling thread only.
+/// @return A pointer to the new pool, or NULL if memory or threads could not be
+/// obtained.
+lj_threadpool_t *lj_new_threadpool(size_t worker_count,
+                                   lj_allocator_t *allocator) {
+  lj_threadpool_t *pool =
+      (lj_threadpool_t *)lj_allocate(allocator, sizeof(lj_threadpool_t));
+  if (pool == NULL) {
+    return NULL;
+  }
+  pool->allocator = allocator;
+  pool->worker_count = worker_count;
+  pool->workers = (lji_threadpool_worker_t *)lj_allocate(
+      allocator, worker_count * sizeof(lji_threadpool_worker_t));
+  pool->inbox = lj_new_mpmc_queue(
+      sizeof(lji_task_t), LJ_THREADPOOL_INBOX_CAPACITY_K, allocator);
+  atomic_init(&pool->running, true);
+  atomic_init(&pool->sleepers, 0);
+  if (pool->workers == NULL || pool->inbox.slots == NULL ||
+      mtx_init(&pool->sleep_lock, mtx_plain) != thrd_success) {
+    lj_mpmc_queue_delete(&pool->inbox);
+    lj_deallocate(allocator, pool->workers);
+    lj_deallocate(allocator, pool);
+    return NULL;
+  }
+  if (cnd_init(&pool->wake) != thrd_success) {
+    mtx_destroy(&pool->sleep_lock);
+    lj_mpmc_queue_delete(&pool->inbox);
+    lj_deallocate(allocator, pool->workers);
+    lj_deallocate(allocator, pool);
+    return NULL;
+  }
+  // every deque must be ready before the first worker goes looking to steal
+  for (size_t i = 0; i < worker_count; i++) {
+    lji_threadpool_worker_t *worker = &pool->workers[i];
+    atomic_init(&worker->top, 0);
+    atomic_init(&worker->bottom, 0);
+    worker->pool = pool;
+    worker->index = i;
+    worker->rng = (size_t)0x9E3779B97F4A7C15ULL * (i + 1U);
+  }
+  for (size_t i = 0; i < worker_count; i++) {
+    if (thrd_create(&pool->workers[i].thread, &lji_threadpool_worker_main,
+                    &pool->workers[i]) != thrd_success) {
+      lji_threadpool_stop(pool, i);
+      return NULL;
+    }
+  }
+  return pool;
+}
+
+/// @brief Gets the number of worker threads in a pool.
+/// @param pool The pool in question.
+/// @return The number of workers.
+size_t lj_threadpool_size(lj_threadpool_t *pool) { return pool->worker_count; }
+
+/// @brief Submit a task to a pool. From a worker the task goes on that
+/// worker's own deque; from any other thread it goes in the pool's shared
+/// inbox. If there is no room, the task runs immediately on the calling
+/// thread.
+/// @param pool The pool in question.
+/// @param fn The task body.
+/// @param ctx Passed to the task body.
+/// @param counter A counter to track the task with, or NULL.
+void lj_threadpool_submit(lj_threadpool_t *pool, lj_task_fn_t fn, void *ctx,
+                          lj_task_counter_t *counter) {
+  lji_task_t task = {.fn = fn, .ctx = ctx, .counter = counter};
+  if (counter != NULL) {
+    atomic_fetch_add_explicit(&counter->pending, 1U, memory_order_relaxed);
+  }
+  lji_threadpool_worker_t *self = lji_threadpool_current_worker;
+  bool queued;
+  if (self != NULL && self->pool == pool) {
+    queued = lji_deque_push(self, task);
+  } else {
+    queued = lj_mpmc_queue_enqueue(&pool->inbox, &task);
+  }
+  if (!queued) {
+    lji_threadpool_run(&task);
+  } else if (atomic_load_explicit(&pool->sleepers, memory_order_relaxed) > 0) {
+    cnd_signal(&pool->wake);
+  }
+}
+
+/// @brief Block until every task tracked by a counter has finished. The
+/// calling thread runs pool tasks while it waits, so this is safe to call from
+/// inside a task.
+/// @param pool The pool the tasks were submitted to.
+/// @param counter The counter in question.
+void lj_threadpool_wait(lj_threadpool_t *pool, lj_task_counter_t *counter) {
+  lji_threadpool_worker_t *self = lji_threadpool_current_worker;
+  if (self != NULL && self->pool != pool) {
+    self = NULL;
+  }
+  lji_task_t task;
+  while (atomic_load_explicit(&counter->pending, memory_order_acquire) != 0U) {
+    if (lji_threadpool_find(pool, self, &task)) {
+      lji_threadpool_run(&task);
+    } else {
+      thrd_yield();
+    }
+  }
+}
+
+/// @brief Signature of a parallel_for loop body; it handles the indices in
+/// [begin, end).
+typedef void (*lj_range_fn_t)(size_t begin, size_t end, void *ctx);
+
+/// @private
+typedef struct {
+  lj_threadpool_t *pool;
+  size_t begin;
+  size_t end;
+  size_t grain;
+  lj_range_fn_t fn;
+  void *ctx;
+  lj_task_counter_t counter;
+  atomic_size_t next_node;
+  struct lji_parallel_for_node_t *nodes;
+} lji_parallel_for_t;
+
+/// @private
+typedef struct lji_parallel_for_node_t {
+  lji_parallel_for_t *loop;
+  size_t first_chunk;
+  size_t last_chunk;
+} lji_parallel_for_node_t;
+
+/// @private
+/// Splits its chunk range in half until one chunk is left, handing the upper
+/// halves to the pool so idle workers can steal them.
+void lji_parallel_for_task(void *ctx) {
+  lji_parallel_for_node_t *node = (lji_parallel_for_node_t *)ctx;
+  lji_parallel_for_t *loop = node->loop;
+  size_t first = node->first_chunk;
+  size_t last = node->last_chunk;
+  while (last - first > 1U) {
+    size_t middle = first + (last - first) / 2U;
+    lji_parallel_for_node_t *upper =
+        &loop->nodes[atomic_fetch_add_explicit(&loop->next_node, 1U,
+                                               memory_order_relaxed)];
+    upper->loop = loop;
+    upper->first_chunk = middle;
+    upper->last_chunk = last;
+    lj_threadpool_submit(loop->pool, &lji_parallel_for_task, upper,
+                         &loop->counter);
+    last = middle;
+  }
+  size_t begin = loop->begin + first * loop->grain;
+  size_t end = loop->end - begin > loop->grain ? begin + loop->grain
+                                               : loop->end;
+  loop->fn(begin, end, loop->ctx);
+}
+
+/// @brief Run a loop body over [begin, end) in parallel, in chunks of grain
+/// indices, and wait for it to finish.
+/// @param pool The pool to run on.
+/// @param begin The first index.
+/// @param end One past the last index.
+/// @param grain The number of indices handed to each call of fn. 0 is treated
+/// as 1.
+/// @param fn The loop body.
+/// @param ctx Passed to the loop body.
+/// @return A bool; if false, bookkeeping memory could not be allocated and
+/// nothing ran.
+bool lj_parallel_for(lj_threadpool_t *pool, size_t begin, size_t end,
+                     size_t grain, lj_range_fn_t fn, void *ctx) {
+  if (begin >= end) {
+    return true;
+  }
+  if (grain == 0U) {
+    grain = 1U;
+  }
+  size_t chunks = (end - begin - 1U) / grain + 1U;
+  lji_parallel_for_t loop = {
+      .pool = pool,
+      .begin = begin,
+      .end = end,
+      .grain = grain,
+      .fn = fn,
+      .ctx = ctx,
+      .counter = lj_new_task_counter(),
+  };
+  atomic_init(&loop.next_node, 1U);
+  loop.nodes = (lji_parallel_for_node_t *)lj_allocate(
+      pool->allocator, chunks * sizeof(lji_parallel_for_node_t));
+  if (loop.nodes == NULL) {
+    return false;
+  }
+  loop.nodes[0] = (lji_parallel_for_node_t){
+      .loop = &loop,
+      .first_chunk = 0U,
+      .last_chunk = chunks,
+  };
+  lj_threadpool_submit(pool, &lji_parallel_for_task, &loop.nodes[0],
+                       &loop.counter);
+  lj_threadpool_wait(pool, &loop.counter);
+  lj_deallocate(pool->allocator, loop.nodes);
+  return true;
+}
+
+/// @private
+size_t lji_parallel_vector_grain(lj_threadpool_t *pool, size_t count) {
+  size_t grain = count / (pool->worker_count * 8U + 1U);
+  return grain < 1024U ? 1024U : grain;
+}
+
+/// @private
+typedef struct {
+  lj_vector_t *vec;
+  const void *val;
+  void (*element_fn)(void *element, void *ctx);
+  void *ctx;
+} lji_parallel_vector_t;
+
+/// @private
+void lji_parallel_vector_fill_range(size_t begin, size_t end, void *ctx) {
+  lji_parallel_vector_t *job = (lji_parallel_vector_t *)ctx;
+  size_t element_size = job->vec->element_size;
+  char *cursor = job->vec->content_start + begin * element_size;
+  char *stop = job->vec->content_start + end * element_size;
+  for (; cursor != stop; cursor += element_size) {
+    memcpy(cursor, job->val, element_size);
+  }
+}
+
+/// @brief Fill a vector with one value in parallel; the number of elements will
+/// remain the same.
+/// @param pool The pool to run on.
+/// @param vec The vector in question.
+/// @param val The value to fill with.
+/// @return A bool; if false, bookkeeping memory could not be allocated and the
+/// vector is unchanged.
+bool lj_parallel_vector_fill(lj_threadpool_t *pool, lj_vector_t *vec,
+                             const void *val) {
+  lji_parallel_vector_t job = {.vec = vec, .val = val};
+  size_t count = lj_vector_size(vec);
+  return lj_parallel_for(pool, 0U, count, lji_parallel_vector_grain(pool, count),
+                         &lji_parallel_vector_fill_range, &job);
+}
+
+/// @private
+void lji_parallel_vector_transform_range(size_t begin, size_t end, void *ctx) {
+  lji_parallel_vector_t *job = (lji_parallel_vector_t *)ctx;
+  size_t element_size = job->vec->element_size;
+  char *cursor = job->vec->content_start + begin * element_size;
+  char *stop = job->vec->content_start + end * element_size;
+  for (; cursor != stop; cursor += element_size) {
+    job->element_fn(cursor, job->ctx);
+  }
+}
+
+/// @brief Apply a function to every element of a vector in place, in parallel.
+/// @param pool The pool to run on.
+/// @param vec The vector in question.
+/// @param fn Called once per element with a pointer to it; calls may happen in
+/// any order and on any thread.
+/// @param ctx Passed to fn.
+/// @return A bool; if false, bookkeeping memory could not be allocated and the
+/// vector is unchanged.
+bool lj_parallel_vector_transform(lj_threadpool_t *pool, lj_vector_t *vec,
+                                  void (*fn)(void *element, void *ctx),
+                                  void *ctx) {
+  lji_parallel_vector_t job = {.vec = vec, .element_fn = fn, .ctx = ctx};
+  size_t count = lj_vector_size(vec);
+  return lj_parallel_for(pool, 0U, count, lji_parallel_vector_grain(pool, count),
+                         &lji_parallel_vector_transform_range, &job);
+}
+
+/// @private
+typedef struct {
+  lj_vector_t *vec;
+  size_t grain;
+  size_t accumulator_size;
+  size_t partial_stride;
+  char *partials;
+  void (*accumulate_fn)(void *acc, const void *element, void *ctx);
+  void *ctx;
+} lji_parallel_reduce_t;
+
+/// @private
+void lji_parallel_vector_reduce_range(size_t begin, size_t end, void *ctx) {
+  lji_parallel_reduce_t *job = (lji_parallel_reduce_t *)ctx;
+  size_t element_size = job->vec->element_size;
+  char *acc = job->partials + (begin / job->grain) * job->partial_stride;
+  char *cursor = job->vec->content_start + begin * element_size;
+  char *stop = job->vec->content_start + end * element_size;
+  for (; cursor != stop; cursor += element_size) {
+    job->accumulate_fn(acc, cursor, job->ctx);
+  }
+}
+
+/// @brief Reduce a vector to a single value in parallel. Each chunk of the
+/// vector is folded into its own copy of the identity, then the partial
+/// results are combined in index order, so the result is deterministic.
+/// @param pool The pool to run on.
+/// @param vec The vector in question.
+/// @param accumulator_size The result of sizeof(accumulator).
+/// @param identity Pointer to the starting accumulator value.
+/// @param accumulate_fn Folds one element into an accumulator.
+/// @param combine_fn Folds the accumulator other into acc.
+/// @param ctx Passed to both functions.
+/// @param out Pointer to a value that will be replaced by the result.
+/// @return A bool; if false, bookkeeping memory could not be allocated and out
+/// is unchanged.
+bool lj_parallel_vector_reduce(
+    lj_threadpool_t *pool, lj_vector_t *vec, size_t accumulator_size,
+    const void *identity,
+    void (*accumulate_fn)(void *acc, const void *element, void *ctx),
+    void (*combine_fn)(void *acc, const void *other, void *ctx), void *ctx,
+    void *out) {
+  size_t count = lj_vector_size(vec);
+  size_t grain = lji_parallel_vector_grain(pool, count);
+  size_t chunks = count == 0U ? 0U : (count - 1U) / grain + 1U;
+  // each partial gets its own cache lines, so workers folding neighbouring
+  // chunks do not keep stealing the same line from each other
+  size_t stride = (accumulator_size + LJ_CACHE_LINE_SIZE_K - 1U) /
+                  LJ_CACHE_LINE_SIZE_K * LJ_CACHE_LINE_SIZE_K;
+  lji_parallel_reduce_t job = {
+      .vec = vec,
+      .grain = grain,
+      .accumulator_size = accumulator_size,
+      .partial_stride = stride,
+      .accumulate_fn = accumulate_fn,
+      .ctx = ctx,
+  };
+  char *raw = (char *)lj_allocate(
+      pool->allocator, (chunks + 1U) * stride + LJ_CACHE_LINE_SIZE_K);
+  if (raw == NULL) {
+    return false;
+  }
+  job.partials = raw + (LJ_CACHE_LINE_SIZE_K -
+                        (uintptr_t)raw % LJ_CACHE_LINE_SIZE_K) %
+                           LJ_CACHE_LINE_SIZE_K;
+  for (size_t i = 0; i < chunks; i++) {
+    memcpy(job.partials + i * stride, identity, accumulator_size);
+  }
+  bool ran = lj_parallel_for(pool, 0U, count, grain,
+                             &lji_parallel_vector_reduce_range, &job);
+  if (ran) {
+    memcpy(out, identity, accumulator_size);
+    for (size_t i = 0; i < chunks; i++) {
+      combine_fn(out, job.partials + i * stride, ctx);
+    }
+  }
+  lj_deallocate(pool->allocator, raw);
+  return ran;
+}
+
+#endif
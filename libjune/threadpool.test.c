@@ -0,0 +1,78 @@
+#include <libjune/threadpool.h>
+#include <libjune/unit.h>
+#include <stdio.h>
+
+static void add_one(void *ctx) { atomic_fetch_add((atomic_int *)ctx, 1); }
+
+static char *test_submit_and_wait(void) {
+  lj_threadpool_t *pool = lj_new_threadpool(4, &lj_default_allocator);
+  lj_assert(pool != NULL, "creating a pool should succeed");
+  atomic_int ran;
+  atomic_init(&ran, 0);
+  lj_task_counter_t counter = lj_new_task_counter();
+  for (int i = 0; i < 10000; i++) {
+    lj_threadpool_submit(pool, &add_one, &ran, &counter);
+  }
+  lj_threadpool_wait(pool, &counter);
+  lj_assert(atomic_load(&ran) == 10000, "every task should run exactly once");
+  lj_threadpool_delete(pool);
+  return 0;
+}
+
+static void mark_range(size_t begin, size_t end, void *ctx) {
+  for (size_t i = begin; i < end; i++) {
+    ((unsigned char *)ctx)[i]++;
+  }
+}
+
+static char *test_parallel_for(void) {
+  lj_threadpool_t *pool = lj_new_threadpool(3, &lj_default_allocator);
+  static unsigned char marks[100003];
+  lj_assert(lj_parallel_for(pool, 3, 100003, 97, &mark_range, marks),
+            "parallel_for should succeed");
+  for (size_t i = 0; i < 100003; i++) {
+    lj_assert(marks[i] == (i < 3 ? 0 : 1),
+              "every index in range should be visited exactly once");
+  }
+  lj_threadpool_delete(pool);
+  return 0;
+}
+
+static void square(void *element, void *ctx) {
+  *(long *)element = *(long *)element * *(long *)element;
+}
+
+static void sum(void *acc, const void *element, void *ctx) {
+  *(long *)acc += *(const long *)element;
+}
+
+static char *test_vector_operations(void) {
+  lj_threadpool_t *pool = lj_new_threadpool(4, &lj_default_allocator);
+  lj_vector_t vec = lj_new_vector(sizeof(long), &lj_default_allocator);
+  long zero = 0;
+  lj_vector_reserve(&vec, 50000);
+  for (int i = 0; i < 50000; i++) {
+    lj_vector_push_back(&vec, &zero);
+  }
+  long three = 3;
+  lj_assert(lj_parallel_vector_fill(pool, &vec, &three),
+            "parallel fill should succeed");
+  lj_assert(lj_parallel_vector_transform(pool, &vec, &square, NULL),
+            "parallel transform should succeed");
+  long total = -1;
+  lj_assert(lj_parallel_vector_reduce(pool, &vec, sizeof(long), &zero, &sum,
+                                      &sum, NULL, &total),
+            "parallel reduce should succeed");
+  lj_assert(total == 50000 * 9, "fill, transform and reduce should compose");
+  lj_delete_vector(&vec);
+  lj_threadpool_delete(pool);
+  return 0;
+}
+
+int main(const int argc, const char **argv) {
+  lj_run_test(test_submit_and_wait);
+  lj_run_test(test_parallel_for);
+  lj_run_test(test_vector_operations);
+  lj_finish_tests();
+  return 0;
+}
@@ -0,0 +1,205 @@
+/// @file libjune/tracing.h
+/// Spans are timed with clock_gettime(CLOCK_MONOTONIC) on POSIX systems. In
+/// strict C modes (-std=c99, -std=c11) the C library hides it unless
+/// _POSIX_C_SOURCE is defined to at least 199309L before any system header,
+/// and this header refuses to compile rather than time spans with a clock that
+/// does not measure wall time. Elsewhere it uses C11 timespec_get.
+
+#ifndef LIBJUNE_TRACING_H
+#define LIBJUNE_TRACING_H
+
+#include <libjune/memory.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(CLOCK_MONOTONIC)
+/// @private
+#define LJI_TRACE_MONOTONIC_CLOCK
+#elif defined(__unix__) || defined(__APPLE__)
+#error "libjune/tracing.h needs CLOCK_MONOTONIC; define _POSIX_C_SOURCE to at least 199309L before including any system header"
+#elif !defined(TIME_UTC)
+#error "libjune/tracing.h needs clock_gettime(CLOCK_MONOTONIC) or C11 timespec_get"
+#endif
+
+/// @brief Category mask that matches every span.
+#define LJ_TRACE_ALL_K 0xFFFFFFFFU
+
+/// @private
+typedef struct {
+  const char *name;
+  uint64_t timestamp_ns;
+  char phase;
+} lji_trace_event_t;
+
+/// @brief Fixed-size ring of trace events belonging to a single thread. Only
+/// the owning thread may record into or flush a tracer, so no locking is ever
+/// needed; give each thread its own.
+typedef struct {
+  lj_allocator_t *allocator;
+  lji_trace_event_t *events;
+  size_t capacity;
+  size_t recorded;
+  uint32_t thread_id;
+  uint32_t enabled_categories;
+} lj_tracer_t;
+
+/// @brief Create a new tracer. All categories start out enabled.
+/// @param capacity The number of events the ring holds before the oldest ones
+/// are overwritten. Rounded up to a power of two.
+/// @param thread_id The thread id reported for this tracer's events.
+/// @param allocator The allocator to use.
+/// @return The new tracer. If allocation failed, its capacity is 0 and
+/// recording into it is a no-op.
+lj_tracer_t lj_tracer_new(size_t capacity, uint32_t thread_id,
+                          lj_allocator_t *allocator) {
+  size_t rounded = 1U;
+  while (rounded < capacity) {
+    rounded <<= 1;
+  }
+  lji_trace_event_t *events = (lji_trace_event_t *)lj_allocate(
+      allocator, rounded * sizeof(lji_trace_event_t));
+  return (lj_tracer_t){
+      .allocator = allocator,
+      .events = events,
+      .capacity = events == NULL ? 0U : rounded,
+      .recorded = 0U,
+      .thread_id = thread_id,
+      .enabled_categories = LJ_TRACE_ALL_K,
+  };
+}
+
+/// @brief Delete a tracer and free its memory. Unflushed events are lost.
+/// @param tracer The tracer to delete.
+void lj_tracer_delete(lj_tracer_t *tracer) {
+  lj_deallocate(tracer->allocator, tracer->events);
+  tracer->events = NULL;
+  tracer->capacity = tracer->recorded = 0U;
+}
+
+/// @brief Choose which span categories a tracer records from now on. Spans in
+/// disabled categories cost a single branch.
+/// @param tracer The tracer in question.
+/// @param categories A bitmask of categories to record.
+void lj_tracer_set_categories(lj_tracer_t *tracer, uint32_t categories) {
+  tracer->enabled_categories = categories;
+}
+
+/// @brief Read the wall clock in nanoseconds. Monotonic on POSIX systems;
+/// without CLOCK_MONOTONIC it is the C11 calendar clock, which can jump if the
+/// system time is changed. Not a pure function.
+/// @return The current time in nanoseconds from an arbitrary epoch.
+uint64_t lj_trace_now_ns(void) {
+  struct timespec now;
+#if defined(LJI_TRACE_MONOTONIC_CLOCK)
+  clock_gettime(CLOCK_MONOTONIC, &now);
+#else
+  timespec_get(&now, TIME_UTC);
+#endif
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/// @brief Record a single event into a tracer. Most code should use the
+/// LJ_TRACE_* macros instead.
+/// @param tracer The tracer in question.
+/// @param category The category bit(s) of the event.
+/// @param name The name of the span. Only the pointer is stored, so it must
+/// outlive the next flush; string literals are ideal.
+/// @param phase 'B' for the start of a span, 'E' for its end.
+void lj_trace_record(lj_tracer_t *tracer, uint32_t category, const char *name,
+                     char phase) {
+  if ((tracer->enabled_categories & category) == 0U ||
+      tracer->capacity == 0U) {
+    return;
+  }
+  lji_trace_event_t *event =
+      &tracer->events[tracer->recorded & (tracer->capacity - 1U)];
+  event->name = name;
+  event->phase = phase;
+  event->timestamp_ns = lj_trace_now_ns();
+  tracer->recorded++;
+}
+
+/// @brief Start a span.
+#define LJ_TRACE_BEGIN(tracer, category, name)                                 \
+  lj_trace_record((tracer), (category), (name), 'B')
+
+/// @brief End the most recently started span.
+#define LJ_TRACE_END(tracer, category, name)                                   \
+  lj_trace_record((tracer), (category), (name), 'E')
+
+/// @private
+#define LJI_TRACE_CONCAT_INNER(a, b) a##b
+/// @private
+#define LJI_TRACE_CONCAT(a, b) LJI_TRACE_CONCAT_INNER(a, b)
+
+/// @brief Wrap the following statement or block in a span. Leaving the block
+/// with break, goto or return skips the end of the span.
+#define LJ_TRACE_SCOPE(tracer, category, name)                                 \
+  for (int LJI_TRACE_CONCAT(lji_trace_once_, __LINE__) =                       \
+           (LJ_TRACE_BEGIN(tracer, category, name), 1);                        \
+       LJI_TRACE_CONCAT(lji_trace_once_, __LINE__);                            \
+       LJI_TRACE_CONCAT(lji_trace_once_, __LINE__) =                           \
+           (LJ_TRACE_END(tracer, category, name), 0))
+
+/// @brief Get the number of events currently held by a tracer.
+/// @param tracer The tracer in question.
+/// @return The number of events that the next flush would write.
+size_t lj_tracer_size(lj_tracer_t *tracer) {
+  return tracer->recorded < tracer->capacity ? tracer->recorded
+                                             : tracer->capacity;
+}
+
+/// @private
+void lji_trace_write_escaped(FILE *out, const char *str) {
+  for (const char *cursor = str; *cursor != '\0'; cursor++) {
+    if (*cursor == '"' || *cursor == '\\') {
+      fputc('\\', out);
+      fputc(*cursor, out);
+    } else if ((unsigned char)*cursor < 0x20U) {
+      fprintf(out, "\\u%04x", (unsigned int)(unsigned char)*cursor);
+    } else {
+      fputc(*cursor, out);
+    }
+  }
+}
+
+/// @brief Write every event held by a tracer as a Chrome trace (the JSON
+/// format read by about:tracing and Perfetto), then empty the tracer. Ends
+/// whose beginning was overwritten when the ring wrapped are left out.
+/// @param tracer The tracer in question.
+/// @param out The file to write to, e.g. the out member of an lj_logger_t.
+/// @return A bool indicating whether every write succeeded.
+bool lj_tracer_flush(lj_tracer_t *tracer, FILE *out) {
+  size_t count = lj_tracer_size(tracer);
+  size_t first = tracer->recorded - count;
+  size_t open_spans = 0U;
+  bool written = false;
+  fputs("{\"traceEvents\":[", out);
+  for (size_t i = 0; i < count; i++) {
+    lji_trace_event_t *event =
+        &tracer->events[(first + i) & (tracer->capacity - 1U)];
+    if (event->phase == 'E') {
+      if (open_spans == 0U) {
+        continue;
+      }
+      open_spans--;
+    } else {
+      open_spans++;
+    }
+    fputs(written ? ",\n{\"name\":\"" : "\n{\"name\":\"", out);
+    written = true;
+    lji_trace_write_escaped(out, event->name);
+    fprintf(out, "\",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":0,\"tid\":%lu}",
+            event->phase,
+            (unsigned long long)(event->timestamp_ns / 1000U),
+            (unsigned int)(event->timestamp_ns % 1000U),
+            (unsigned long)tracer->thread_id);
+  }
+  fputs("\n]}\n", out);
+  tracer->recorded = 0U;
+  return fflush(out) == 0 && !ferror(out);
+}
+
+#endif
@@ -0,0 +1,90 @@
+#define _POSIX_C_SOURCE 199309L
+#include <libjune/tracing.h>
+#include <libjune/unit.h>
+#include <stdio.h>
+#include <string.h>
+
+static char *test_ring_wraps(void) {
+  lj_tracer_t tracer = lj_tracer_new(5, 1, &lj_default_allocator);
+  lj_assert(tracer.capacity == 8, "capacity should round up to a power of two");
+  for (int i = 0; i < 20; i++) {
+    LJ_TRACE_BEGIN(&tracer, 1U, "span");
+  }
+  lj_assert(lj_tracer_size(&tracer) == 8,
+            "a full tracer should only hold its capacity");
+  lj_tracer_delete(&tracer);
+  return 0;
+}
+
+static char *test_categories(void) {
+  lj_tracer_t tracer = lj_tracer_new(16, 1, &lj_default_allocator);
+  lj_tracer_set_categories(&tracer, 2U);
+  LJ_TRACE_SCOPE(&tracer, 1U, "disabled") {
+    LJ_TRACE_SCOPE(&tracer, 2U, "enabled") {}
+  }
+  lj_assert(lj_tracer_size(&tracer) == 2,
+            "only spans in enabled categories should be recorded");
+  lj_assert(tracer.events[0].phase == 'B' && tracer.events[1].phase == 'E',
+            "a scope should record a begin and an end");
+  lj_tracer_delete(&tracer);
+  return 0;
+}
+
+static char *test_flush(void) {
+  lj_tracer_t tracer = lj_tracer_new(16, 7, &lj_default_allocator);
+  LJ_TRACE_SCOPE(&tracer, LJ_TRACE_ALL_K, "say \"hi\"") {}
+  FILE *out = tmpfile();
+  lj_assert(lj_tracer_flush(&tracer, out), "flushing should succeed");
+  lj_assert(lj_tracer_size(&tracer) == 0, "flushing should empty the tracer");
+  char buffer[512] = {0};
+  rewind(out);
+  fread(buffer, 1, sizeof(buffer) - 1, out);
+  fclose(out);
+  lj_assert(strstr(buffer, "\"name\":\"say \\\"hi\\\"\"") != NULL,
+            "names should be escaped");
+  lj_assert(strstr(buffer, "\"tid\":7") != NULL,
+            "the thread id should be written");
+  lj_tracer_delete(&tracer);
+  return 0;
+}
+
+static char *test_unmatched_ends_dropped(void) {
+  lj_tracer_t tracer = lj_tracer_new(4, 1, &lj_default_allocator);
+  LJ_TRACE_BEGIN(&tracer, 1U, "outer");
+  LJ_TRACE_BEGIN(&tracer, 1U, "lost");
+  LJ_TRACE_SCOPE(&tracer, 1U, "kept") {}
+  LJ_TRACE_END(&tracer, 1U, "lost");
+  LJ_TRACE_END(&tracer, 1U, "outer");
+  FILE *out = tmpfile();
+  lj_assert(lj_tracer_flush(&tracer, out), "flushing should succeed");
+  char buffer[512] = {0};
+  rewind(out);
+  fread(buffer, 1, sizeof(buffer) - 1, out);
+  fclose(out);
+  lj_assert(strstr(buffer, "\"kept\"") != NULL,
+            "complete spans should be written");
+  lj_assert(strstr(buffer, "\"lost\"") == NULL &&
+                strstr(buffer, "\"outer\"") == NULL,
+            "ends whose beginning was overwritten should be dropped");
+  lj_tracer_delete(&tracer);
+  return 0;
+}
+
+static char *test_clock_counts_sleep(void) {
+  uint64_t start = lj_trace_now_ns();
+  struct timespec nap = {0, 20000000L};
+  nanosleep(&nap, NULL);
+  lj_assert(lj_trace_now_ns() - start >= 15000000U,
+            "time spent asleep should count towards a span");
+  return 0;
+}
+
+int main(const int argc, const char **argv) {
+  lj_run_test(test_ring_wraps);
+  lj_run_test(test_categories);
+  lj_run_test(test_flush);
+  lj_run_test(test_unmatched_ends_dropped);
+  lj_run_test(test_clock_counts_sleep);
+  lj_finish_tests();
+  return 0;
+}